@@ -16,6 +16,7 @@ extern "C" {
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "cfsm_event.h"
 #include "cfsm_nullptr.h"
 
 /**
@@ -24,6 +25,19 @@ extern "C" {
 struct cfsm_state;
 
 typedef void (*cfsm_state_action_f)(struct cfsm_state *state, int event_id, void *event_data);
+typedef bool (*cfsm_defer_f)(struct cfsm_state *state, int event_id, void *event_data);
+
+/**
+ * transition in flight, started by asynchronous action and not completed yet
+ */
+struct cfsm_pending {
+    struct cfsm_transition *transition; // nullptr if no transition is in flight
+    struct cfsm_event *event; // owned envelope, nullptr for events given by cfsm_process_event
+    int event_id;
+    void *event_data;
+    bool *completed; // set by completion while asynchronous action has not returned yet
+    bool drain; // transition completed from within asynchronous action, inbox has to be drained
+};
 
 struct cfsm_state {
     const char *name;
@@ -33,13 +47,36 @@ struct cfsm_state {
     cfsm_state_action_f entry_action;
     cfsm_state_action_f exit_action;
 
+    // decides whether unhandled event should wait on deferred queue of owning fsm
+    cfsm_defer_f defer;
+
     // sub-fsm
     int num_states;
     struct cfsm_state *states;
     struct cfsm_state *initial_state;
     struct cfsm_state *current_state;
+
+    // nullptr until fsm needs to keep events, see cfsm_get_runtime
+    struct cfsm_runtime *runtime;
+};
+
+/**
+ * per-machine runtime kept out of cfsm_state, so that leaf states and machines
+ * which never queue events nor start asynchronous transitions stay small
+ */
+struct cfsm_runtime {
+    // owned envelopes waiting for processing
+    struct cfsm_event_queue deferred;
+    struct cfsm_event_queue inbox;
+
+    struct cfsm_pending pending;
 };
 
+/**
+ * @return runtime of fsm, allocated on first call. nullptr if out of memory
+ */
+struct cfsm_runtime *cfsm_get_runtime(struct cfsm_state *fsm);
+
 /**
  * install fsm within a state, effectively prepare state to contain substates amd accept process event calls
  * @param state state to be promoted
@@ -55,6 +92,7 @@ struct cfsm_state *cfsm_init_state(struct cfsm_state *state, const char *name);
 void cfsm_state_destroy(struct cfsm_state *fsm);
 
 void cfsm_null_state_action(struct cfsm_state *state, int event_id, void *event_data);
+bool cfsm_null_defer(struct cfsm_state *state, int event_id, void *event_data);
 
 /**
  * CFSM TRANSITION
@@ -69,12 +107,19 @@ struct cfsm_transition_list {
 typedef void (*cfsm_action_f)(struct cfsm_state *origin, struct cfsm_state *next, int event_id, void *event_data);
 typedef bool (*cfsm_guard_f)(struct cfsm_state *origin, struct cfsm_state *next, int event_id, void *event_data);
 
+/**
+ * action which may suspend, fsm stays in transition until cfsm_complete_transition(fsm) is called
+ */
+typedef void (*cfsm_async_action_f)(struct cfsm_state *fsm, struct cfsm_state *origin, struct cfsm_state *next,
+                                    int event_id, void *event_data);
+
 struct cfsm_transition {
     struct cfsm_state *source;
     int event_id;
     struct cfsm_state *target;
     cfsm_action_f action;
     cfsm_guard_f guard;
+    cfsm_async_action_f async_action; // called instead of action if set
 };
 
 bool cfsm_null_guard(struct cfsm_state *source, struct cfsm_state *target, int event_id, void *event_data);
@@ -90,6 +135,7 @@ cfsm_init_transition_ag(struct cfsm_transition *t, struct cfsm_state *source, st
 
 void cfsm_transition_set_action(struct cfsm_transition *t, cfsm_action_f action);
 void cfsm_transition_set_guard(struct cfsm_transition *t, cfsm_guard_f guard);
+void cfsm_transition_set_async_action(struct cfsm_transition *t, cfsm_async_action_f async_action);
 
 bool cfsm_transition_is_internal(struct cfsm_transition *t);
 
@@ -106,11 +152,43 @@ enum cfsm_status {
     cfsm_status_ok,
     cfsm_status_not_ok,
     cfsm_status_guard_rejected,
-    cfsm_status_deffered
+    cfsm_status_deffered,
+    cfsm_status_pending, // asynchronous action started, transition completes later
+    cfsm_status_queued // fsm is in transition, event waits on inbox
 };
 
 enum cfsm_status cfsm_process_event(struct cfsm_state *fsm, int event_id, void *event_data);
 
+/**
+ * process event taking ownership over the envelope. Envelope is released once consumed or kept on deferred
+ * queue if current state defers it (cfsm_status_deffered is returned then).
+ * Deferred events are reconsidered in order of appearance after every state change:
+ * accepted or guard rejected ones are released, those without transition stay on the queue.
+ */
+enum cfsm_status cfsm_process_event_sink(struct cfsm_state *fsm, struct cfsm_event *event);
+
+/**
+ * enqueue envelope on fsm inbox without processing, fsm takes ownership
+ * @return false if out of memory, envelope is released then
+ */
+bool cfsm_post_event(struct cfsm_state *fsm, struct cfsm_event *event);
+
+/**
+ * process all envelopes waiting in fsm inbox, stops early when fsm enters asynchronous transition
+ * @return number of processed envelopes
+ */
+int cfsm_dispatch(struct cfsm_state *fsm);
+
+/**
+ * CFSM ASYNCHRONOUS TRANSITIONS
+ * While asynchronous action is in flight, exit action of source state has been called and fsm still points
+ * to source state. Incoming events are queued on inbox (cfsm_process_event does not copy payload, so it has
+ * to outlive the transition). Completion enters target state, then deferred and inbox events are processed.
+ */
+bool cfsm_is_in_transition(struct cfsm_state *fsm);
+
+void cfsm_complete_transition(struct cfsm_state *fsm);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,75 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_BULK_H_
+#define LIBCFSM_CFSM_BULK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cfsm.h"
+
+/**
+ * CFSM BULK
+ * lockstep processing of many instances sharing single machine definition.
+ * Instance is represented only by index of its current state within fsm->states, -1 means stopped.
+ * Only the top level of the definition is stepped, guards and actions receive states of shared definition.
+ */
+struct cfsm_bulk {
+    struct cfsm_state *fsm;
+    int num_states;
+    int num_events;
+    int *event_ids; // sorted, distinct
+
+    // per (event, state + 1) tables, column of one event is contiguous, slot 0 belongs to stopped instances
+    int *targets;
+    int *status;
+    unsigned char *slow; // guard, action, entry or exit have to be called or more than one candidate exists
+    bool *pure; // per event, column has no slow entries
+};
+
+/**
+ * compile per-(state,event) target table of given machine definition
+ * @param bulk bulk context to be initialized
+ * @param fsm machine definition, all transition targets must belong to fsm->states, no asynchronous transitions
+ * @return false if definition cannot be compiled or memory is exhausted
+ */
+bool cfsm_bulk_init(struct cfsm_bulk *bulk, struct cfsm_state *fsm);
+
+void cfsm_bulk_destroy(struct cfsm_bulk *bulk);
+
+/**
+ * @return index of state within definition or -1 if state does not belong to it
+ */
+int cfsm_bulk_state_index(struct cfsm_bulk *bulk, struct cfsm_state *state);
+
+/**
+ * put all instances into initial state, entry action is called once per instance
+ */
+void cfsm_bulk_start(struct cfsm_bulk *bulk, int *states, int count, int event_id, void *event_data);
+
+/**
+ * apply single event to all instances
+ * @param states packed array of instance state indices, updated in place
+ * @param statuses optional per instance result, may be nullptr
+ * @return number of instances that took a transition
+ */
+int cfsm_bulk_process_event(struct cfsm_bulk *bulk, int event_id, void *event_data, int *states,
+                            enum cfsm_status *statuses, int count);
+
+/**
+ * same as cfsm_bulk_process_event, but instances are split evenly across num_threads threads.
+ * Guards and actions may then be called concurrently.
+ */
+int cfsm_bulk_process_event_mt(struct cfsm_bulk *bulk, int event_id, void *event_data, int *states,
+                               enum cfsm_status *statuses, int count, int num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCFSM_CFSM_BULK_H_ */
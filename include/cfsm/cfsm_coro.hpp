@@ -0,0 +1,89 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_CORO_HPP_
+#define LIBCFSM_CFSM_CORO_HPP_
+
+#include "cfsm.h"
+
+// <coroutine> exists in some C++20 modes without compiler support (GCC 10 needs -fcoroutines)
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+
+/**
+ * CFSM COROUTINE ADAPTER
+ * C++20 coroutine as asynchronous transition action. Coroutine runs until its first suspension point,
+ * transition is completed when coroutine body finishes. Exceptions escaping coroutine terminate the program.
+ *
+ *   cfsm::async_action load(cfsm::transition_context context) { co_await io; }
+ *   cfsm_transition_set_async_action(&t, cfsm::async<load>);
+ */
+namespace cfsm {
+
+struct transition_context {
+    cfsm_state *fsm;
+    cfsm_state *origin;
+    cfsm_state *next;
+    int event_id;
+    void *event_data;
+};
+
+class async_action {
+public:
+    struct promise_type {
+        explicit promise_type(const transition_context &context) noexcept : fsm(context.fsm) {}
+
+        async_action get_return_object() noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        auto final_suspend() noexcept {
+            struct completion {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    // frame is gone before completion runs entry action and processes queued events
+                    cfsm_state *fsm = handle.promise().fsm;
+                    handle.destroy();
+                    cfsm_complete_transition(fsm);
+                }
+
+                void await_resume() noexcept {}
+            };
+            return completion{};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+
+        cfsm_state *fsm;
+    };
+};
+
+/**
+ * cfsm_async_action_f calling coroutine Action
+ */
+template <async_action (*Action)(transition_context)>
+void async(cfsm_state *fsm, cfsm_state *origin, cfsm_state *next, int event_id, void *event_data) {
+    Action(transition_context{fsm, origin, next, event_id, event_data});
+}
+
+} // namespace cfsm
+
+#endif
+
+#endif /* LIBCFSM_CFSM_CORO_HPP_ */
@@ -0,0 +1,127 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_EVENT_H_
+#define LIBCFSM_CFSM_EVENT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "cfsm_nullptr.h"
+
+/**
+ * CFSM EVENT
+ */
+struct cfsm_event_pool;
+
+/**
+ * payload deleter, signature compatible with free()
+ */
+typedef void (*cfsm_event_deleter_f)(void *event_data);
+
+/**
+ * event envelope - carries event id together with payload and knowledge how to release it
+ */
+struct cfsm_event {
+    int event_id;
+    void *event_data;
+    size_t size; // payload size in bytes, 0 if unknown
+    cfsm_event_deleter_f deleter; // called over event_data on release, nullptr if payload is not owned
+
+    // bookkeeping, do not touch
+    struct cfsm_event *next;
+    struct cfsm_event_pool *pool;
+    int size_class;
+};
+
+/**
+ * allocate envelope with inline payload of given size, payload is released together with envelope
+ * @param pool pool to allocate from, nullptr means plain malloc
+ * @param event_id event id
+ * @param size payload size in bytes, event_data points to uninitialized storage of that size (nullptr if size is 0)
+ * @return envelope or nullptr if out of memory
+ */
+struct cfsm_event *cfsm_event_alloc(struct cfsm_event_pool *pool, int event_id, size_t size);
+
+/**
+ * allocate envelope taking ownership over external payload
+ * @param pool pool to allocate from, nullptr means plain malloc
+ * @param event_id event id
+ * @param event_data payload
+ * @param size payload size in bytes, 0 if unknown
+ * @param deleter called over payload on release, nullptr if payload is not owned by envelope
+ * @return envelope or nullptr if out of memory (payload is not released then)
+ */
+struct cfsm_event *cfsm_event_wrap(struct cfsm_event_pool *pool, int event_id, void *event_data, size_t size,
+                                   cfsm_event_deleter_f deleter);
+
+/**
+ * release payload and return envelope to its pool, compatible with std::unique_ptr deleter
+ */
+void cfsm_event_release(struct cfsm_event *event);
+
+/**
+ * CFSM EVENT POOL
+ * size-class allocator for envelopes and small inline payloads. Not thread safe.
+ */
+#define CFSM_EVENT_POOL_NUM_CLASSES 5
+#define CFSM_EVENT_POOL_MAX_PAYLOAD 256
+#define CFSM_EVENT_POOL_DEFAULT_CHUNK 64
+
+struct cfsm_event_pool_chunk;
+
+struct cfsm_event_pool {
+    struct cfsm_event *free_list[CFSM_EVENT_POOL_NUM_CLASSES];
+    struct cfsm_event_pool_chunk *chunks;
+    int blocks_per_chunk;
+};
+
+/**
+ * @param pool pool to be initialized
+ * @param blocks_per_chunk number of blocks fetched from heap at once for each size class, 0 means default
+ * @return pointer to initialized pool
+ */
+struct cfsm_event_pool *cfsm_event_pool_init(struct cfsm_event_pool *pool, int blocks_per_chunk);
+
+/**
+ * give all memory back to heap. All envelopes allocated from the pool become invalid.
+ */
+void cfsm_event_pool_destroy(struct cfsm_event_pool *pool);
+
+/**
+ * CFSM EVENT QUEUE
+ * intrusive FIFO of envelopes, queue owns envelopes it contains
+ */
+struct cfsm_event_queue {
+    struct cfsm_event *head;
+    struct cfsm_event *tail;
+    int size;
+};
+
+void cfsm_event_queue_init(struct cfsm_event_queue *queue);
+
+void cfsm_event_queue_push(struct cfsm_event_queue *queue, struct cfsm_event *event);
+
+struct cfsm_event *cfsm_event_queue_pop(struct cfsm_event_queue *queue);
+
+/**
+ * unlink event following prev (or head if prev is nullptr), ownership goes to caller
+ */
+struct cfsm_event *cfsm_event_queue_unlink(struct cfsm_event_queue *queue, struct cfsm_event *prev);
+
+/**
+ * release all contained envelopes
+ */
+void cfsm_event_queue_clear(struct cfsm_event_queue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCFSM_CFSM_EVENT_H_ */
@@ -0,0 +1,133 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_JOURNAL_H_
+#define LIBCFSM_CFSM_JOURNAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "cfsm.h"
+
+/**
+ * CFSM JOURNAL
+ * append-only binary record of events given to cfsm_process_event: event id, payload bytes,
+ * resulting status and resulting state index. Records are written in host byte order.
+ * Each thread appends into its own writer buffer, full buffers are written to file by background thread.
+ * Events journaled by actions through the same writer are recorded as nested behind event which caused them.
+ *
+ * Records of different writers interleave in file in buffer hand over order, so replay is deterministic only
+ * per writer: every machine has to be driven through single writer of the journal, and is replayed against
+ * records of that writer. Each record carries id of its writer.
+ */
+#define CFSM_JOURNAL_VERSION 3
+#define CFSM_JOURNAL_BUFFER_SIZE (1 << 16)
+
+/**
+ * write payload into buffer
+ * @return number of bytes written, value above capacity means payload does not fit
+ */
+typedef size_t (*cfsm_journal_serialize_f)(int event_id, const void *event_data, void *buffer, size_t capacity);
+
+/**
+ * rebuild payload from bytes, returned pointer has to stay valid until next call
+ */
+typedef void *(*cfsm_journal_deserialize_f)(int event_id, const void *bytes, size_t size, void *context);
+
+struct cfsm_journal_buffer;
+
+struct cfsm_journal {
+    FILE *out;
+    cfsm_journal_serialize_f serialize;
+    bool ok;
+
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_cond_t drained;
+    bool closing;
+    int num_writers;
+    int in_flight; // buffers handed over but not yet written
+    struct cfsm_journal_buffer *full_head;
+    struct cfsm_journal_buffer *full_tail;
+    struct cfsm_journal_buffer *free_list;
+};
+
+/**
+ * per-thread handle used to append records
+ */
+struct cfsm_journal_writer {
+    struct cfsm_journal *journal;
+    int id; // assigned in order of cfsm_journal_writer_init calls, starting from 0
+    struct cfsm_journal_buffer *buffer;
+    int depth; // number of journaled events being processed
+    struct cfsm_journal_buffer *held_head; // full buffers with records still waiting for outcome
+    struct cfsm_journal_buffer *held_tail;
+};
+
+/**
+ * write journal header and start background flush thread
+ * @param serialize payload serializer, nullptr records no payload
+ * @return false if header could not be written or thread could not be started
+ */
+bool cfsm_journal_open(struct cfsm_journal *journal, FILE *out, cfsm_journal_serialize_f serialize);
+
+/**
+ * wait until all handed over buffers are written, stop flush thread and release buffers.
+ * All writers have to be flushed beforehand.
+ * @return false if any write failed
+ */
+bool cfsm_journal_close(struct cfsm_journal *journal);
+
+/**
+ * wait until all handed over buffers are written
+ */
+bool cfsm_journal_sync(struct cfsm_journal *journal);
+
+/**
+ * @return false if journal ran out of writer ids
+ */
+bool cfsm_journal_writer_init(struct cfsm_journal_writer *writer, struct cfsm_journal *journal);
+
+/**
+ * hand over partially filled buffer to flush thread, no effect from within journaled event
+ */
+void cfsm_journal_writer_flush(struct cfsm_journal_writer *writer);
+
+/**
+ * cfsm_process_event with its input and outcome appended to journal
+ */
+enum cfsm_status cfsm_journal_process_event(struct cfsm_journal_writer *writer, struct cfsm_state *fsm, int event_id,
+                                            void *event_data);
+
+/**
+ * CFSM REPLAY
+ */
+struct cfsm_replay_report {
+    long events; // records of selected writer, nested included
+    long mismatches;
+    long first_mismatch; // index of first record with different outcome, -1 if none
+};
+
+/**
+ * drive machine with journaled events read in large blocks and compare every outcome with recorded one.
+ * Nested records are not dispatched, actions of their parent event are expected to produce them again.
+ * Their own outcomes are not compared, only their effect on state recorded for the parent.
+ * @param writer_id id of writer which drove the machine, -1 if journal was written by single writer
+ * @param deserialize payload deserializer, nullptr passes pointer to raw payload bytes
+ * @return false on read error, malformed journal or records of many writers when writer_id is -1
+ */
+bool cfsm_journal_replay(FILE *in, int writer_id, struct cfsm_state *fsm, cfsm_journal_deserialize_f deserialize,
+                         void *context, struct cfsm_replay_report *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCFSM_CFSM_JOURNAL_H_ */
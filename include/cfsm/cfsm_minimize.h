@@ -0,0 +1,52 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_MINIMIZE_H_
+#define LIBCFSM_CFSM_MINIMIZE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cfsm.h"
+
+/**
+ * CFSM MINIMIZATION
+ * States are equivalent if they share entry, exit and defer actions and their transitions
+ * on the same events carry the same action and guard and lead to equivalent states.
+ */
+struct cfsm_minimized {
+    struct cfsm_state fsm; // minimized machine, owns states and transitions below
+    int num_states;
+    struct cfsm_state *states;
+    int num_transitions;
+    struct cfsm_transition *transitions;
+
+    struct cfsm_state *original_states;
+    int num_original_states;
+    int *state_map; // index within original fsm->states -> index within minimized states
+};
+
+/**
+ * build minimal machine equivalent to given definition, O(m log n) for n states and m transitions
+ * @param fsm stopped, flat machine definition with at most one transition per (state, event) pair
+ * @param minimized output, release with cfsm_minimized_destroy
+ * @return false if definition cannot be minimized or memory is exhausted
+ */
+bool cfsm_minimize(struct cfsm_state *fsm, struct cfsm_minimized *minimized);
+
+void cfsm_minimized_destroy(struct cfsm_minimized *minimized);
+
+/**
+ * @return state of minimized machine which replaces given state of original definition
+ */
+struct cfsm_state *cfsm_minimized_state(struct cfsm_minimized *minimized, struct cfsm_state *original);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCFSM_CFSM_MINIMIZE_H_ */
@@ -0,0 +1,99 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_PRIORITY_H_
+#define LIBCFSM_CFSM_PRIORITY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cfsm.h"
+
+/**
+ * CFSM PRIORITY QUEUE
+ * input queue placed in front of cfsm_process_event_sink. Every event id belongs to priority class,
+ * each class is fixed capacity ring kept in caller provided storage, so push and pop never allocate.
+ * Events of more urgent class are always dispatched first, order within class is FIFO.
+ * Event ids marked as idempotent are coalesced while waiting in queue.
+ */
+#define CFSM_PRIORITY_MAX_CLASSES 8
+
+enum cfsm_coalesce {
+    cfsm_coalesce_none,
+    cfsm_coalesce_keep_latest, // newer event replaces queued one in its place
+    cfsm_coalesce_drop_duplicates // newer event is dropped while one is queued
+};
+
+struct cfsm_priority_rule {
+    int event_id;
+    int priority; // 0 is the most urgent class
+    enum cfsm_coalesce coalesce;
+};
+
+struct cfsm_priority_ring {
+    struct cfsm_event **slots;
+    int capacity;
+    int head;
+    int size;
+};
+
+struct cfsm_priority_queue {
+    const struct cfsm_priority_rule *rules; // sorted by event_id, may be shared by many queues
+    int num_rules;
+    int *queued; // per rule, slot holding queued event of that id, -1 if none
+    int num_classes;
+    struct cfsm_priority_ring rings[CFSM_PRIORITY_MAX_CLASSES];
+
+    long dropped; // envelopes released because their class was full
+    long coalesced; // envelopes merged with queued ones
+};
+
+/**
+ * @param queue queue to be initialized
+ * @param rules per event id rules sorted by event_id, used by queue until cleared. Event ids without rule
+ *              go to the least urgent class and are never coalesced.
+ * @param num_rules number of rules
+ * @param queued num_rules ints of per-queue bookkeeping
+ * @param num_classes number of priority classes, 1 to CFSM_PRIORITY_MAX_CLASSES
+ * @param storage num_classes * capacity envelope pointers
+ * @param capacity capacity of single class
+ * @return false if parameters are out of range, rules are not sorted or event id repeats
+ */
+bool cfsm_priority_queue_init(struct cfsm_priority_queue *queue, const struct cfsm_priority_rule *rules,
+                              int num_rules, int *queued, int num_classes, struct cfsm_event **storage,
+                              int capacity);
+
+/**
+ * release all queued envelopes
+ */
+void cfsm_priority_queue_clear(struct cfsm_priority_queue *queue);
+
+/**
+ * queue takes ownership over envelope in any case
+ * @return false if envelope was released instead of queued (class full or duplicate dropped)
+ */
+bool cfsm_priority_queue_push(struct cfsm_priority_queue *queue, struct cfsm_event *event);
+
+/**
+ * @return the oldest envelope of the most urgent non-empty class, nullptr if queue is empty
+ */
+struct cfsm_event *cfsm_priority_queue_pop(struct cfsm_priority_queue *queue);
+
+int cfsm_priority_queue_size(struct cfsm_priority_queue *queue);
+
+/**
+ * feed queued envelopes into cfsm_process_event_sink, stops early when fsm enters asynchronous transition
+ * @param max_events limit of processed envelopes, negative means no limit
+ * @return number of processed envelopes
+ */
+int cfsm_priority_queue_dispatch(struct cfsm_priority_queue *queue, struct cfsm_state *fsm, int max_events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCFSM_CFSM_PRIORITY_H_ */
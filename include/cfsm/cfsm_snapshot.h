@@ -0,0 +1,58 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#pragma once
+
+#ifndef LIBCFSM_CFSM_SNAPSHOT_H_
+#define LIBCFSM_CFSM_SNAPSHOT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cfsm.h"
+#include "cfsm_bulk.h"
+
+/**
+ * CFSM SNAPSHOT
+ * runtime state of machines written as state indices in single streaming pass.
+ * For every instance current state index is stored together with current states of all nested sub-machines
+ * (history of inactive ones included), followed by deferred and inbox queues.
+ * Queued payloads are copied byte by byte, envelope with unknown payload size is restored without payload.
+ * Snapshot is self-delimiting, restore reads exactly its bytes and leaves the rest of stream untouched,
+ * so pipes and sockets work without seeking.
+ */
+#define CFSM_SNAPSHOT_VERSION 2
+
+/**
+ * @param out binary stream
+ * @param fsms instances to be written
+ * @param count number of instances
+ * @return false on write error or when any machine is in asynchronous transition
+ */
+bool cfsm_snapshot(FILE *out, struct cfsm_state **fsms, int count);
+
+/**
+ * rebuild runtime state of instances sharing definition with snapshotted ones, no actions are called.
+ * Whole snapshot is validated first, instances are left untouched if false is returned.
+ * @param in binary stream
+ * @param fsms instances to be restored, their queues and transition in flight are released
+ * @param count number of instances, has to match snapshot
+ * @param pool pool used for restored envelopes, nullptr means plain malloc
+ * @return false on read error or snapshot not matching definition
+ */
+bool cfsm_restore(FILE *in, struct cfsm_state **fsms, int count, struct cfsm_event_pool *pool);
+
+/**
+ * snapshot of bulk population, see cfsm_bulk. Restore leaves states untouched if false is returned.
+ */
+bool cfsm_bulk_snapshot(FILE *out, struct cfsm_bulk *bulk, const int *states, int count);
+
+bool cfsm_bulk_restore(FILE *in, struct cfsm_bulk *bulk, int *states, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCFSM_CFSM_SNAPSHOT_H_ */
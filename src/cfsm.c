@@ -12,11 +12,21 @@ static inline bool cfsm_is_stopped(struct cfsm_state *fsm) {
     return nullptr == fsm->current_state;
 }
 
+static void cfsm_init_pending(struct cfsm_pending *pending) {
+    pending->transition = nullptr;
+    pending->event = nullptr;
+    pending->event_id = 0;
+    pending->event_data = nullptr;
+    pending->completed = nullptr;
+    pending->drain = false;
+}
+
 struct cfsm_state *cfsm_init(struct cfsm_state *state, int num_states, struct cfsm_state *states, struct cfsm_state *initial_state) {
     state->num_states = num_states;
     state->states = states;
     state->initial_state = initial_state;
     state->current_state = nullptr;
+    state->runtime = nullptr;
     return state;
 }
 
@@ -26,12 +36,14 @@ struct cfsm_state *cfsm_init_state(struct cfsm_state *state, const char *name) {
     state->transitions = nullptr;
     state->entry_action = cfsm_null_state_action;
     state->exit_action = cfsm_null_state_action;
+    state->defer = cfsm_null_defer;
 
     // a state does not contain submachine by default, need cfsm_init_state_fsm call
     state->num_states = 0;
     state->states = nullptr;
     state->initial_state = nullptr;
     state->current_state = nullptr;
+    state->runtime = nullptr;
     return state;
 }
 
@@ -59,6 +71,28 @@ void cfsm_state_destroy(struct cfsm_state *fsm) {
     }
 
     fsm->num_transitions = 0;
+
+    if (nullptr != fsm->runtime) {
+        cfsm_event_queue_clear(&fsm->runtime->deferred);
+        cfsm_event_queue_clear(&fsm->runtime->inbox);
+        cfsm_event_release(fsm->runtime->pending.event);
+        free(fsm->runtime);
+        fsm->runtime = nullptr;
+    }
+}
+
+struct cfsm_runtime *cfsm_get_runtime(struct cfsm_state *fsm) {
+    if (nullptr == fsm->runtime) {
+        struct cfsm_runtime *runtime = malloc(sizeof(struct cfsm_runtime));
+        if (nullptr == runtime) {
+            return nullptr;
+        }
+        cfsm_event_queue_init(&runtime->deferred);
+        cfsm_event_queue_init(&runtime->inbox);
+        cfsm_init_pending(&runtime->pending);
+        fsm->runtime = runtime;
+    }
+    return fsm->runtime;
 }
 
 void cfsm_null_state_action(struct cfsm_state *state, int event_id, void *event_data) {
@@ -67,6 +101,13 @@ void cfsm_null_state_action(struct cfsm_state *state, int event_id, void *event_
     (void)event_data;
 }
 
+bool cfsm_null_defer(struct cfsm_state *state, int event_id, void *event_data) {
+    (void)state;
+    (void)event_id;
+    (void)event_data;
+    return false;
+}
+
 void cfsm_null_action(struct cfsm_state *source, struct cfsm_state *target, int event_id, void *event_data) {
     (void)source;
     (void)target;
@@ -93,6 +134,7 @@ struct cfsm_transition *cfsm_init_transition_ag(struct cfsm_transition *t, struc
 
     cfsm_transition_set_action(t, action);
     cfsm_transition_set_guard(t, guard);
+    cfsm_transition_set_async_action(t, nullptr);
 
     return t;
 }
@@ -105,6 +147,10 @@ void cfsm_transition_set_action(struct cfsm_transition *t, cfsm_action_f action)
     t->action = action;
 }
 
+void cfsm_transition_set_async_action(struct cfsm_transition *t, cfsm_async_action_f async_action) {
+    t->async_action = async_action;
+}
+
 void cfsm_add_transition(struct cfsm_state *fsm, struct cfsm_transition *t) {
     if (cfsm_is_started(fsm)) {
         // WARN: modification of already running state machine is prohibited!
@@ -135,6 +181,10 @@ void cfsm_stop(struct cfsm_state *fsm, int event_id, void *event_data) {
         // WARN: called cfsm_stop over already stopped fsm. No effect.
         return;
     }
+    if (cfsm_is_in_transition(fsm)) {
+        // WARN: called cfsm_stop during asynchronous transition. No effect, complete it first!
+        return;
+    }
 
     struct cfsm_state * current_state = fsm->current_state;
     current_state->exit_action(current_state, event_id, event_data);
@@ -147,13 +197,13 @@ void cfsm_restart(struct cfsm_state *fsm, int event_id, void *event_data) {
     cfsm_start(fsm, event_id, event_data);
 }
 
-enum cfsm_status cfsm_process_event(struct cfsm_state *fsm, int event_id, void *event_data) {
+/**
+ * @param owned envelope carrying the event if any, set to nullptr when asynchronous transition takes ownership
+ */
+static enum cfsm_status cfsm_fire_transition(struct cfsm_state *fsm, int event_id, void *event_data,
+                                             struct cfsm_event **owned) {
     enum cfsm_status result = cfsm_status_not_ok; // -> transition not found
 
-    if (cfsm_is_stopped(fsm)) {
-        cfsm_start(fsm, event_id, event_data);
-    }
-
     struct cfsm_state *current_state = fsm->current_state; // get current state O(1);
     // find transition from current state on event_id O(s->num_transition)
     struct cfsm_transition_list *transition_node = current_state->transitions;
@@ -162,7 +212,34 @@ enum cfsm_status cfsm_process_event(struct cfsm_state *fsm, int event_id, void *
 
         if (event_id == t->event_id) {
             if (t->guard(t->source, t->target, event_id, event_data)) {
+                struct cfsm_runtime *runtime = nullptr;
+                if (nullptr != t->async_action && nullptr == (runtime = cfsm_get_runtime(fsm))) {
+                    // ERROR: out of memory, asynchronous transition cannot be tracked
+                    return cfsm_status_not_ok;
+                }
+
                 t->source->exit_action(t->source, event_id, event_data); //! FIXME: call exit only if target != source
+                if (nullptr != t->async_action) {
+                    bool completed = false;
+                    runtime->pending.transition = t;
+                    runtime->pending.event_id = event_id;
+                    runtime->pending.event_data = event_data;
+                    runtime->pending.completed = &completed;
+                    t->async_action(fsm, t->source, t->target, event_id, event_data);
+
+                    if (completed) {
+                        // completed before action returned, events queued meanwhile are left to caller.
+                        // Entry action of target may have started another asynchronous transition already.
+                        if (!cfsm_is_in_transition(fsm)) {
+                            runtime->pending.drain = true;
+                        }
+                        return cfsm_status_ok;
+                    }
+                    runtime->pending.completed = nullptr;
+                    runtime->pending.event = *owned;
+                    *owned = nullptr;
+                    return cfsm_status_pending;
+                }
                 t->action(t->source, t->target, event_id, event_data);
                 fsm->current_state = t->target;
                 t->target->entry_action(t->target, event_id, event_data); //! FIXME: call entry only if target != source
@@ -178,6 +255,165 @@ enum cfsm_status cfsm_process_event(struct cfsm_state *fsm, int event_id, void *
     return result;
 }
 
+static void cfsm_process_deferred(struct cfsm_state *fsm) {
+    struct cfsm_event_queue *deferred = &fsm->runtime->deferred;
+    struct cfsm_event *prev = nullptr;
+    struct cfsm_event *event = deferred->head;
+    while (nullptr != event) {
+        struct cfsm_event *owned = event;
+        enum cfsm_status status = cfsm_fire_transition(fsm, event->event_id, event->event_data, &owned);
+        if (cfsm_status_not_ok == status) {
+            // transition not found leaves event on deferred queue
+            prev = event;
+            event = event->next;
+            continue;
+        }
+
+        cfsm_event_queue_unlink(deferred, prev);
+        cfsm_event_release(owned);
+
+        if (cfsm_status_pending == status || cfsm_is_in_transition(fsm)) {
+            // the rest waits for transition to complete
+            return;
+        }
+        if (cfsm_status_ok == status) {
+            // state changed, look for the oldest matching event again
+            prev = nullptr;
+            event = deferred->head;
+        } else {
+            event = nullptr == prev ? deferred->head : prev->next;
+        }
+    }
+}
+
+/**
+ * called after successful transition: replay deferred events, then drain inbox filled during transition
+ * which completed synchronously
+ */
+static void cfsm_settle(struct cfsm_state *fsm) {
+    struct cfsm_runtime *runtime = fsm->runtime;
+    if (nullptr == runtime || cfsm_is_in_transition(fsm)) {
+        // transition started meanwhile settles fsm once completed
+        return;
+    }
+    if (nullptr != runtime->deferred.head) {
+        cfsm_process_deferred(fsm);
+    }
+    if (runtime->pending.drain && !cfsm_is_in_transition(fsm)) {
+        runtime->pending.drain = false;
+        cfsm_dispatch(fsm);
+    }
+}
+
+enum cfsm_status cfsm_process_event(struct cfsm_state *fsm, int event_id, void *event_data) {
+    if (cfsm_is_in_transition(fsm)) {
+        // payload is not owned, queue it as borrowed
+        struct cfsm_event *event = cfsm_event_wrap(nullptr, event_id, event_data, 0, nullptr);
+        if (nullptr == event || !cfsm_post_event(fsm, event)) {
+            return cfsm_status_not_ok;
+        }
+        return cfsm_status_queued;
+    }
+
+    if (cfsm_is_stopped(fsm)) {
+        cfsm_start(fsm, event_id, event_data);
+    }
+
+    struct cfsm_event *owned = nullptr;
+    enum cfsm_status result = cfsm_fire_transition(fsm, event_id, event_data, &owned);
+    if (cfsm_status_ok == result) {
+        cfsm_settle(fsm);
+    }
+    return result;
+}
+
+enum cfsm_status cfsm_process_event_sink(struct cfsm_state *fsm, struct cfsm_event *event) {
+    if (cfsm_is_in_transition(fsm)) {
+        return cfsm_post_event(fsm, event) ? cfsm_status_queued : cfsm_status_not_ok;
+    }
+
+    if (cfsm_is_stopped(fsm)) {
+        cfsm_start(fsm, event->event_id, event->event_data);
+    }
+
+    struct cfsm_event *owned = event;
+    enum cfsm_status result = cfsm_fire_transition(fsm, event->event_id, event->event_data, &owned);
+    if (cfsm_status_not_ok == result &&
+        fsm->current_state->defer(fsm->current_state, event->event_id, event->event_data)) {
+        struct cfsm_runtime *runtime = cfsm_get_runtime(fsm);
+        if (nullptr == runtime) {
+            // ERROR: out of memory, event cannot be deferred
+            cfsm_event_release(event);
+            return cfsm_status_not_ok;
+        }
+        cfsm_event_queue_push(&runtime->deferred, event);
+        return cfsm_status_deffered;
+    }
+
+    cfsm_event_release(owned);
+    if (cfsm_status_ok == result) {
+        cfsm_settle(fsm);
+    }
+    return result;
+}
+
+bool cfsm_post_event(struct cfsm_state *fsm, struct cfsm_event *event) {
+    struct cfsm_runtime *runtime = cfsm_get_runtime(fsm);
+    if (nullptr == runtime) {
+        // ERROR: out of memory, event is dropped
+        cfsm_event_release(event);
+        return false;
+    }
+    cfsm_event_queue_push(&runtime->inbox, event);
+    return true;
+}
+
+int cfsm_dispatch(struct cfsm_state *fsm) {
+    int processed = 0;
+    struct cfsm_event *event = nullptr;
+    while (nullptr != fsm->runtime && !cfsm_is_in_transition(fsm) &&
+           nullptr != (event = cfsm_event_queue_pop(&fsm->runtime->inbox))) {
+        cfsm_process_event_sink(fsm, event);
+        ++processed;
+    }
+    return processed;
+}
+
+bool cfsm_is_in_transition(struct cfsm_state *fsm) {
+    return nullptr != fsm->runtime && nullptr != fsm->runtime->pending.transition;
+}
+
+void cfsm_complete_transition(struct cfsm_state *fsm) {
+    if (!cfsm_is_in_transition(fsm)) {
+        // WARN: no transition in flight. No effect.
+        return;
+    }
+
+    // take over pending record, entry action may start another asynchronous transition
+    struct cfsm_pending *pending = &fsm->runtime->pending;
+    struct cfsm_transition *t = pending->transition;
+    struct cfsm_event *event = pending->event;
+    bool *completed = pending->completed;
+    const int event_id = pending->event_id;
+    void *event_data = pending->event_data;
+    cfsm_init_pending(pending);
+
+    fsm->current_state = t->target;
+    t->target->entry_action(t->target, event_id, event_data);
+
+    if (nullptr != completed) {
+        // completed from within asynchronous action, cfsm_fire_transition carries on
+        *completed = true;
+        return;
+    }
+
+    cfsm_event_release(event);
+    if (!cfsm_is_in_transition(fsm)) {
+        pending->drain = true;
+        cfsm_settle(fsm);
+    }
+}
+
 bool cfsm_transition_is_internal(struct cfsm_transition *t) {
     return t->source == t->target;
 }
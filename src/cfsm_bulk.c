@@ -0,0 +1,318 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include "cfsm/cfsm_bulk.h"
+
+#include <pthread.h>
+
+static int cfsm_compare_int(const void *lhs, const void *rhs) {
+    int a = *(const int *)lhs;
+    int b = *(const int *)rhs;
+    return (a > b) - (a < b);
+}
+
+static int cfsm_bulk_event_index(struct cfsm_bulk *bulk, int event_id) {
+    int *found = bsearch(&event_id, bulk->event_ids, bulk->num_events, sizeof(int), cfsm_compare_int);
+    return nullptr != found ? (int)(found - bulk->event_ids) : -1;
+}
+
+int cfsm_bulk_state_index(struct cfsm_bulk *bulk, struct cfsm_state *state) {
+    if (state < bulk->fsm->states || state >= bulk->fsm->states + bulk->num_states) {
+        return -1;
+    }
+    return (int)(state - bulk->fsm->states);
+}
+
+static bool cfsm_bulk_collect_events(struct cfsm_bulk *bulk) {
+    int num_transitions = 0;
+    for (int i = 0; i < bulk->num_states; ++i) {
+        num_transitions += bulk->fsm->states[i].num_transitions;
+    }
+
+    bulk->event_ids = malloc(sizeof(int) * (num_transitions > 0 ? num_transitions : 1));
+    if (nullptr == bulk->event_ids) {
+        return false;
+    }
+
+    int n = 0;
+    for (int i = 0; i < bulk->num_states; ++i) {
+        for (struct cfsm_transition_list *node = bulk->fsm->states[i].transitions; nullptr != node; node = node->next) {
+            if (cfsm_bulk_state_index(bulk, node->transition->target) < 0) {
+                // ERROR: transition leads outside of the definition
+                return false;
+            }
+            if (nullptr != node->transition->async_action) {
+                // ERROR: asynchronous transition needs per-instance pending state, use cfsm_process_event
+                return false;
+            }
+            bulk->event_ids[n++] = node->transition->event_id;
+        }
+    }
+
+    qsort(bulk->event_ids, n, sizeof(int), cfsm_compare_int);
+    bulk->num_events = 0;
+    for (int i = 0; i < n; ++i) {
+        if (0 == bulk->num_events || bulk->event_ids[bulk->num_events - 1] != bulk->event_ids[i]) {
+            bulk->event_ids[bulk->num_events++] = bulk->event_ids[i];
+        }
+    }
+    return true;
+}
+
+static void cfsm_bulk_compile_entry(struct cfsm_bulk *bulk, int state_index, int event_index) {
+    const int stride = bulk->num_states + 1;
+    const int slot = event_index * stride + state_index + 1;
+    const int event_id = bulk->event_ids[event_index];
+
+    struct cfsm_transition *candidate = nullptr;
+    int num_candidates = 0;
+    for (struct cfsm_transition_list *node = bulk->fsm->states[state_index].transitions; nullptr != node; node = node->next) {
+        if (event_id == node->transition->event_id) {
+            candidate = node->transition;
+            ++num_candidates;
+        }
+    }
+
+    bulk->targets[slot] = state_index;
+    bulk->status[slot] = cfsm_status_not_ok;
+    bulk->slow[slot] = 0;
+
+    if (0 == num_candidates) {
+        return;
+    }
+
+    if (1 == num_candidates && cfsm_null_guard == candidate->guard && cfsm_null_action == candidate->action &&
+        cfsm_null_state_action == candidate->source->exit_action &&
+        cfsm_null_state_action == candidate->target->entry_action) {
+        bulk->targets[slot] = cfsm_bulk_state_index(bulk, candidate->target);
+        bulk->status[slot] = cfsm_status_ok;
+        return;
+    }
+
+    bulk->slow[slot] = 1;
+    bulk->pure[event_index] = false;
+}
+
+bool cfsm_bulk_init(struct cfsm_bulk *bulk, struct cfsm_state *fsm) {
+    bulk->fsm = fsm;
+    bulk->num_states = fsm->num_states;
+    bulk->num_events = 0;
+    bulk->event_ids = nullptr;
+    bulk->targets = nullptr;
+    bulk->status = nullptr;
+    bulk->slow = nullptr;
+    bulk->pure = nullptr;
+
+    if (!cfsm_bulk_collect_events(bulk)) {
+        cfsm_bulk_destroy(bulk);
+        return false;
+    }
+
+    const size_t slots = (size_t)bulk->num_events * (bulk->num_states + 1) + 1;
+    bulk->targets = malloc(sizeof(int) * slots);
+    bulk->status = malloc(sizeof(int) * slots);
+    bulk->slow = malloc(sizeof(unsigned char) * slots);
+    bulk->pure = malloc(sizeof(bool) * (bulk->num_events + 1));
+    if (nullptr == bulk->targets || nullptr == bulk->status || nullptr == bulk->slow || nullptr == bulk->pure) {
+        cfsm_bulk_destroy(bulk);
+        return false;
+    }
+
+    for (int e = 0; e < bulk->num_events; ++e) {
+        const int stopped_slot = e * (bulk->num_states + 1);
+        bulk->targets[stopped_slot] = -1;
+        bulk->status[stopped_slot] = cfsm_status_not_ok;
+        bulk->slow[stopped_slot] = 0;
+        bulk->pure[e] = true;
+
+        for (int s = 0; s < bulk->num_states; ++s) {
+            cfsm_bulk_compile_entry(bulk, s, e);
+        }
+    }
+    return true;
+}
+
+void cfsm_bulk_destroy(struct cfsm_bulk *bulk) {
+    free(bulk->event_ids);
+    free(bulk->targets);
+    free(bulk->status);
+    free(bulk->slow);
+    free(bulk->pure);
+
+    bulk->event_ids = nullptr;
+    bulk->targets = nullptr;
+    bulk->status = nullptr;
+    bulk->slow = nullptr;
+    bulk->pure = nullptr;
+    bulk->num_events = 0;
+}
+
+void cfsm_bulk_start(struct cfsm_bulk *bulk, int *states, int count, int event_id, void *event_data) {
+    struct cfsm_state *initial_state = bulk->fsm->initial_state;
+    const int initial_index = cfsm_bulk_state_index(bulk, initial_state);
+
+    for (int i = 0; i < count; ++i) {
+        states[i] = initial_index;
+    }
+
+    if (cfsm_null_state_action != initial_state->entry_action) {
+        for (int i = 0; i < count; ++i) {
+            initial_state->entry_action(initial_state, event_id, event_data);
+        }
+    }
+}
+
+static int cfsm_bulk_fire(struct cfsm_bulk *bulk, int state_index, int event_id, void *event_data,
+                          enum cfsm_status *status) {
+    *status = cfsm_status_not_ok;
+
+    struct cfsm_transition_list *transition_node = bulk->fsm->states[state_index].transitions;
+    while (nullptr != transition_node) {
+        struct cfsm_transition *t = transition_node->transition;
+
+        if (event_id == t->event_id) {
+            if (t->guard(t->source, t->target, event_id, event_data)) {
+                t->source->exit_action(t->source, event_id, event_data);
+                t->action(t->source, t->target, event_id, event_data);
+                t->target->entry_action(t->target, event_id, event_data);
+                *status = cfsm_status_ok;
+                return cfsm_bulk_state_index(bulk, t->target);
+            } else {
+                *status = cfsm_status_guard_rejected;
+            }
+        }
+
+        transition_node = transition_node->next;
+    }
+
+    return state_index;
+}
+
+// table lookup only, kept free of calls and branches so that compiler may vectorize it
+static int cfsm_bulk_gather(const int *restrict targets, const int *restrict status, int *restrict states,
+                            enum cfsm_status *restrict statuses, int count) {
+    int taken = 0;
+    if (nullptr == statuses) {
+        for (int i = 0; i < count; ++i) {
+            const int slot = states[i] + 1;
+            taken += cfsm_status_ok == status[slot];
+            states[i] = targets[slot];
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            const int slot = states[i] + 1;
+            statuses[i] = (enum cfsm_status)status[slot];
+            taken += cfsm_status_ok == status[slot];
+            states[i] = targets[slot];
+        }
+    }
+    return taken;
+}
+
+int cfsm_bulk_process_event(struct cfsm_bulk *bulk, int event_id, void *event_data, int *states,
+                            enum cfsm_status *statuses, int count) {
+    const int event_index = cfsm_bulk_event_index(bulk, event_id);
+    if (event_index < 0) {
+        if (nullptr != statuses) {
+            for (int i = 0; i < count; ++i) {
+                statuses[i] = cfsm_status_not_ok;
+            }
+        }
+        return 0;
+    }
+
+    const int offset = event_index * (bulk->num_states + 1);
+    const int *targets = bulk->targets + offset;
+    const int *status = bulk->status + offset;
+
+    if (bulk->pure[event_index]) {
+        return cfsm_bulk_gather(targets, status, states, statuses, count);
+    }
+
+    const unsigned char *slow = bulk->slow + offset;
+    int taken = 0;
+    for (int i = 0; i < count; ++i) {
+        const int slot = states[i] + 1;
+        enum cfsm_status result = (enum cfsm_status)status[slot];
+        if (slow[slot]) {
+            states[i] = cfsm_bulk_fire(bulk, states[i], event_id, event_data, &result);
+        } else {
+            states[i] = targets[slot];
+        }
+
+        taken += cfsm_status_ok == result;
+        if (nullptr != statuses) {
+            statuses[i] = result;
+        }
+    }
+    return taken;
+}
+
+struct cfsm_bulk_job {
+    pthread_t thread;
+    bool spawned;
+    struct cfsm_bulk *bulk;
+    int event_id;
+    void *event_data;
+    int *states;
+    enum cfsm_status *statuses;
+    int count;
+    int taken;
+};
+
+static void *cfsm_bulk_job_run(void *arg) {
+    struct cfsm_bulk_job *job = arg;
+    job->taken = cfsm_bulk_process_event(job->bulk, job->event_id, job->event_data, job->states, job->statuses,
+                                         job->count);
+    return nullptr;
+}
+
+int cfsm_bulk_process_event_mt(struct cfsm_bulk *bulk, int event_id, void *event_data, int *states,
+                               enum cfsm_status *statuses, int count, int num_threads) {
+    if (num_threads > count) {
+        num_threads = count;
+    }
+    if (num_threads <= 1) {
+        return cfsm_bulk_process_event(bulk, event_id, event_data, states, statuses, count);
+    }
+
+    struct cfsm_bulk_job *jobs = malloc(sizeof(struct cfsm_bulk_job) * num_threads);
+    if (nullptr == jobs) {
+        return cfsm_bulk_process_event(bulk, event_id, event_data, states, statuses, count);
+    }
+
+    const int chunk = (count + num_threads - 1) / num_threads;
+    int begin = 0;
+    for (int i = 0; i < num_threads; ++i) {
+        const int end = begin + chunk < count ? begin + chunk : count;
+        jobs[i].bulk = bulk;
+        jobs[i].event_id = event_id;
+        jobs[i].event_data = event_data;
+        jobs[i].states = states + begin;
+        jobs[i].statuses = nullptr != statuses ? statuses + begin : nullptr;
+        jobs[i].count = end - begin;
+        jobs[i].taken = 0;
+        begin = end;
+    }
+
+    // first chunk is handled by calling thread, failed spawn falls back to calling thread as well
+    for (int i = 1; i < num_threads; ++i) {
+        jobs[i].spawned = 0 == pthread_create(&jobs[i].thread, nullptr, cfsm_bulk_job_run, &jobs[i]);
+        if (!jobs[i].spawned) {
+            cfsm_bulk_job_run(&jobs[i]);
+        }
+    }
+    cfsm_bulk_job_run(&jobs[0]);
+
+    int taken = jobs[0].taken;
+    for (int i = 1; i < num_threads; ++i) {
+        if (jobs[i].spawned) {
+            pthread_join(jobs[i].thread, nullptr);
+        }
+        taken += jobs[i].taken;
+    }
+
+    free(jobs);
+    return taken;
+}
@@ -0,0 +1,200 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include "cfsm/cfsm_event.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct cfsm_event_pool_chunk {
+    struct cfsm_event_pool_chunk *next;
+};
+
+static const size_t cfsm_event_class_payload[CFSM_EVENT_POOL_NUM_CLASSES] = {0, 32, 64, 128, 256};
+
+static inline size_t cfsm_align(size_t size) {
+    const size_t alignment = _Alignof(max_align_t);
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static inline size_t cfsm_event_header_size(void) {
+    return cfsm_align(sizeof(struct cfsm_event));
+}
+
+static inline void *cfsm_event_inline_payload(struct cfsm_event *event) {
+    return (char *)event + cfsm_event_header_size();
+}
+
+static int cfsm_event_size_class(size_t size) {
+    for (int i = 0; i < CFSM_EVENT_POOL_NUM_CLASSES; ++i) {
+        if (size <= cfsm_event_class_payload[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool cfsm_event_pool_grow(struct cfsm_event_pool *pool, int size_class) {
+    const size_t block_size = cfsm_event_header_size() + cfsm_event_class_payload[size_class];
+    const size_t chunk_header_size = cfsm_align(sizeof(struct cfsm_event_pool_chunk));
+
+    struct cfsm_event_pool_chunk *chunk = malloc(chunk_header_size + block_size * pool->blocks_per_chunk);
+    if (nullptr == chunk) {
+        return false;
+    }
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+
+    char *block = (char *)chunk + chunk_header_size;
+    for (int i = 0; i < pool->blocks_per_chunk; ++i, block += block_size) {
+        struct cfsm_event *event = (struct cfsm_event *)block;
+        event->next = pool->free_list[size_class];
+        pool->free_list[size_class] = event;
+    }
+    return true;
+}
+
+static struct cfsm_event *cfsm_event_get_block(struct cfsm_event_pool *pool, int size_class) {
+    struct cfsm_event *event = nullptr;
+    if (nullptr == pool) {
+        event = malloc(cfsm_event_header_size() + cfsm_event_class_payload[size_class]);
+    } else {
+        if (nullptr == pool->free_list[size_class] && !cfsm_event_pool_grow(pool, size_class)) {
+            return nullptr;
+        }
+        event = pool->free_list[size_class];
+        pool->free_list[size_class] = event->next;
+    }
+
+    if (nullptr != event) {
+        event->next = nullptr;
+        event->pool = pool;
+        event->size_class = size_class;
+    }
+    return event;
+}
+
+struct cfsm_event *cfsm_event_alloc(struct cfsm_event_pool *pool, int event_id, size_t size) {
+    int size_class = cfsm_event_size_class(size);
+    if (size_class < 0) {
+        // payload too big to be kept inline, fall back to heap
+        void *event_data = malloc(size);
+        if (nullptr == event_data) {
+            return nullptr;
+        }
+        struct cfsm_event *event = cfsm_event_wrap(pool, event_id, event_data, size, free);
+        if (nullptr == event) {
+            free(event_data);
+        }
+        return event;
+    }
+
+    struct cfsm_event *event = cfsm_event_get_block(pool, size_class);
+    if (nullptr == event) {
+        return nullptr;
+    }
+    event->event_id = event_id;
+    event->event_data = size != 0 ? cfsm_event_inline_payload(event) : nullptr;
+    event->size = size;
+    event->deleter = nullptr;
+    return event;
+}
+
+struct cfsm_event *cfsm_event_wrap(struct cfsm_event_pool *pool, int event_id, void *event_data, size_t size,
+                                   cfsm_event_deleter_f deleter) {
+    struct cfsm_event *event = cfsm_event_get_block(pool, 0);
+    if (nullptr == event) {
+        return nullptr;
+    }
+    event->event_id = event_id;
+    event->event_data = event_data;
+    event->size = size;
+    event->deleter = deleter;
+    return event;
+}
+
+void cfsm_event_release(struct cfsm_event *event) {
+    if (nullptr == event) {
+        return;
+    }
+
+    if (nullptr != event->deleter) {
+        event->deleter(event->event_data);
+    }
+
+    struct cfsm_event_pool *pool = event->pool;
+    if (nullptr == pool) {
+        free(event);
+        return;
+    }
+    event->next = pool->free_list[event->size_class];
+    pool->free_list[event->size_class] = event;
+}
+
+struct cfsm_event_pool *cfsm_event_pool_init(struct cfsm_event_pool *pool, int blocks_per_chunk) {
+    for (int i = 0; i < CFSM_EVENT_POOL_NUM_CLASSES; ++i) {
+        pool->free_list[i] = nullptr;
+    }
+    pool->chunks = nullptr;
+    pool->blocks_per_chunk = blocks_per_chunk > 0 ? blocks_per_chunk : CFSM_EVENT_POOL_DEFAULT_CHUNK;
+    return pool;
+}
+
+void cfsm_event_pool_destroy(struct cfsm_event_pool *pool) {
+    while (nullptr != pool->chunks) {
+        struct cfsm_event_pool_chunk *head = pool->chunks;
+        pool->chunks = head->next;
+        free(head);
+    }
+    for (int i = 0; i < CFSM_EVENT_POOL_NUM_CLASSES; ++i) {
+        pool->free_list[i] = nullptr;
+    }
+}
+
+void cfsm_event_queue_init(struct cfsm_event_queue *queue) {
+    queue->head = nullptr;
+    queue->tail = nullptr;
+    queue->size = 0;
+}
+
+void cfsm_event_queue_push(struct cfsm_event_queue *queue, struct cfsm_event *event) {
+    event->next = nullptr;
+    if (nullptr == queue->tail) {
+        queue->head = event;
+    } else {
+        queue->tail->next = event;
+    }
+    queue->tail = event;
+    ++queue->size;
+}
+
+struct cfsm_event *cfsm_event_queue_pop(struct cfsm_event_queue *queue) {
+    return cfsm_event_queue_unlink(queue, nullptr);
+}
+
+struct cfsm_event *cfsm_event_queue_unlink(struct cfsm_event_queue *queue, struct cfsm_event *prev) {
+    struct cfsm_event *event = nullptr == prev ? queue->head : prev->next;
+    if (nullptr == event) {
+        return nullptr;
+    }
+
+    if (nullptr == prev) {
+        queue->head = event->next;
+    } else {
+        prev->next = event->next;
+    }
+    if (queue->tail == event) {
+        queue->tail = prev;
+    }
+    --queue->size;
+
+    event->next = nullptr;
+    return event;
+}
+
+void cfsm_event_queue_clear(struct cfsm_event_queue *queue) {
+    while (nullptr != queue->head) {
+        cfsm_event_release(cfsm_event_queue_pop(queue));
+    }
+}
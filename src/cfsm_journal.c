@@ -0,0 +1,384 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include "cfsm/cfsm_journal.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static const unsigned char cfsm_journal_magic[4] = {'C', 'F', 'S', 'J'};
+
+struct cfsm_journal_buffer {
+    struct cfsm_journal_buffer *next;
+    size_t used;
+    unsigned char data[CFSM_JOURNAL_BUFFER_SIZE];
+};
+
+/**
+ * record header, followed by payload padded to 8 bytes
+ */
+struct cfsm_journal_record {
+    uint32_t size;
+    int32_t event_id;
+    int32_t state;
+    uint8_t status;
+    uint8_t depth; // 0 for events given from outside, nesting level (saturated) for events journaled by actions
+    uint16_t writer;
+};
+
+static inline size_t cfsm_journal_padded(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+static void *cfsm_journal_flush_run(void *arg) {
+    struct cfsm_journal *journal = arg;
+
+    pthread_mutex_lock(&journal->lock);
+    for (;;) {
+        while (nullptr == journal->full_head && !journal->closing) {
+            pthread_cond_wait(&journal->wakeup, &journal->lock);
+        }
+
+        struct cfsm_journal_buffer *buffer = journal->full_head;
+        if (nullptr == buffer) {
+            break;
+        }
+        journal->full_head = buffer->next;
+        if (nullptr == journal->full_head) {
+            journal->full_tail = nullptr;
+        }
+
+        pthread_mutex_unlock(&journal->lock);
+        const bool written = fwrite(buffer->data, 1, buffer->used, journal->out) == buffer->used;
+        pthread_mutex_lock(&journal->lock);
+
+        journal->ok = journal->ok && written;
+        buffer->next = journal->free_list;
+        journal->free_list = buffer;
+        --journal->in_flight;
+        pthread_cond_broadcast(&journal->drained);
+    }
+    pthread_mutex_unlock(&journal->lock);
+
+    return nullptr;
+}
+
+bool cfsm_journal_open(struct cfsm_journal *journal, FILE *out, cfsm_journal_serialize_f serialize) {
+    journal->out = out;
+    journal->serialize = serialize;
+    journal->ok = true;
+    journal->closing = false;
+    journal->num_writers = 0;
+    journal->in_flight = 0;
+    journal->full_head = nullptr;
+    journal->full_tail = nullptr;
+    journal->free_list = nullptr;
+
+    const uint32_t version = CFSM_JOURNAL_VERSION;
+    if (fwrite(cfsm_journal_magic, 1, sizeof(cfsm_journal_magic), out) != sizeof(cfsm_journal_magic) ||
+        fwrite(&version, 1, sizeof(version), out) != sizeof(version)) {
+        return false;
+    }
+
+    pthread_mutex_init(&journal->lock, nullptr);
+    pthread_cond_init(&journal->wakeup, nullptr);
+    pthread_cond_init(&journal->drained, nullptr);
+    if (0 != pthread_create(&journal->flusher, nullptr, cfsm_journal_flush_run, journal)) {
+        pthread_cond_destroy(&journal->drained);
+        pthread_cond_destroy(&journal->wakeup);
+        pthread_mutex_destroy(&journal->lock);
+        return false;
+    }
+    return true;
+}
+
+bool cfsm_journal_sync(struct cfsm_journal *journal) {
+    pthread_mutex_lock(&journal->lock);
+    while (0 != journal->in_flight) {
+        pthread_cond_wait(&journal->drained, &journal->lock);
+    }
+    bool result = journal->ok;
+    pthread_mutex_unlock(&journal->lock);
+
+    return result && 0 == fflush(journal->out);
+}
+
+bool cfsm_journal_close(struct cfsm_journal *journal) {
+    pthread_mutex_lock(&journal->lock);
+    journal->closing = true;
+    pthread_cond_signal(&journal->wakeup);
+    pthread_mutex_unlock(&journal->lock);
+
+    pthread_join(journal->flusher, nullptr);
+
+    while (nullptr != journal->free_list) {
+        struct cfsm_journal_buffer *head = journal->free_list;
+        journal->free_list = head->next;
+        free(head);
+    }
+
+    pthread_cond_destroy(&journal->drained);
+    pthread_cond_destroy(&journal->wakeup);
+    pthread_mutex_destroy(&journal->lock);
+
+    return journal->ok && 0 == fflush(journal->out);
+}
+
+static struct cfsm_journal_buffer *cfsm_journal_take_buffer(struct cfsm_journal *journal) {
+    pthread_mutex_lock(&journal->lock);
+    struct cfsm_journal_buffer *buffer = journal->free_list;
+    if (nullptr != buffer) {
+        journal->free_list = buffer->next;
+    }
+    pthread_mutex_unlock(&journal->lock);
+
+    if (nullptr == buffer) {
+        buffer = malloc(sizeof(struct cfsm_journal_buffer));
+    }
+    if (nullptr != buffer) {
+        buffer->next = nullptr;
+        buffer->used = 0;
+    }
+    return buffer;
+}
+
+static void cfsm_journal_hand_over(struct cfsm_journal *journal, struct cfsm_journal_buffer *buffer) {
+    pthread_mutex_lock(&journal->lock);
+    buffer->next = nullptr;
+    if (nullptr == journal->full_tail) {
+        journal->full_head = buffer;
+    } else {
+        journal->full_tail->next = buffer;
+    }
+    journal->full_tail = buffer;
+    ++journal->in_flight;
+    pthread_cond_signal(&journal->wakeup);
+    pthread_mutex_unlock(&journal->lock);
+}
+
+bool cfsm_journal_writer_init(struct cfsm_journal_writer *writer, struct cfsm_journal *journal) {
+    pthread_mutex_lock(&journal->lock);
+    writer->id = journal->num_writers <= UINT16_MAX ? journal->num_writers++ : -1;
+    pthread_mutex_unlock(&journal->lock);
+
+    writer->journal = journal;
+    writer->buffer = nullptr;
+    writer->depth = 0;
+    writer->held_head = nullptr;
+    writer->held_tail = nullptr;
+    return -1 != writer->id;
+}
+
+/**
+ * give up current buffer: empty one goes back to free list, full one to flush thread,
+ * unless it may still contain record waiting for its outcome
+ */
+static void cfsm_journal_writer_retire(struct cfsm_journal_writer *writer) {
+    struct cfsm_journal_buffer *buffer = writer->buffer;
+    writer->buffer = nullptr;
+
+    if (0 == buffer->used) {
+        pthread_mutex_lock(&writer->journal->lock);
+        buffer->next = writer->journal->free_list;
+        writer->journal->free_list = buffer;
+        pthread_mutex_unlock(&writer->journal->lock);
+    } else if (0 != writer->depth) {
+        buffer->next = nullptr;
+        if (nullptr == writer->held_tail) {
+            writer->held_head = buffer;
+        } else {
+            writer->held_tail->next = buffer;
+        }
+        writer->held_tail = buffer;
+    } else {
+        cfsm_journal_hand_over(writer->journal, buffer);
+    }
+}
+
+static void cfsm_journal_writer_release_held(struct cfsm_journal_writer *writer) {
+    while (nullptr != writer->held_head) {
+        struct cfsm_journal_buffer *buffer = writer->held_head;
+        writer->held_head = buffer->next;
+        cfsm_journal_hand_over(writer->journal, buffer);
+    }
+    writer->held_tail = nullptr;
+}
+
+void cfsm_journal_writer_flush(struct cfsm_journal_writer *writer) {
+    if (0 != writer->depth) {
+        // WARN: flush from within journaled event. Buffers are handed over once outermost event is processed.
+        return;
+    }
+    if (nullptr != writer->buffer) {
+        cfsm_journal_writer_retire(writer);
+    }
+}
+
+/**
+ * make room for record header and serialize payload right behind it
+ * @return payload size or 0 if payload does not fit into empty buffer
+ */
+static size_t cfsm_journal_reserve(struct cfsm_journal_writer *writer, int event_id, const void *event_data) {
+    const size_t header_size = sizeof(struct cfsm_journal_record);
+    cfsm_journal_serialize_f serialize = writer->journal->serialize;
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (nullptr == writer->buffer || CFSM_JOURNAL_BUFFER_SIZE - writer->buffer->used < header_size) {
+            if (nullptr != writer->buffer) {
+                cfsm_journal_writer_retire(writer);
+            }
+            writer->buffer = cfsm_journal_take_buffer(writer->journal);
+            if (nullptr == writer->buffer) {
+                return 0;
+            }
+        }
+
+        if (nullptr == serialize) {
+            return 0;
+        }
+
+        struct cfsm_journal_buffer *buffer = writer->buffer;
+        // keep room for padding, so that records stay 8 byte aligned
+        const size_t capacity = (CFSM_JOURNAL_BUFFER_SIZE - buffer->used - header_size) & ~(size_t)7;
+        const size_t size = serialize(event_id, event_data, buffer->data + buffer->used + header_size, capacity);
+        if (size <= capacity) {
+            return size;
+        }
+
+        if (0 == buffer->used) {
+            // WARN: payload does not fit even into empty buffer, event is journaled without payload
+            return 0;
+        }
+        cfsm_journal_writer_retire(writer);
+    }
+    return 0;
+}
+
+enum cfsm_status cfsm_journal_process_event(struct cfsm_journal_writer *writer, struct cfsm_state *fsm, int event_id,
+                                            void *event_data) {
+    const size_t size = cfsm_journal_reserve(writer, event_id, event_data);
+
+    struct cfsm_journal_buffer *buffer = writer->buffer;
+    if (nullptr == buffer) {
+        // ERROR: out of memory, event is not journaled
+        return cfsm_process_event(fsm, event_id, event_data);
+    }
+
+    // commit record before processing, so that events journaled by actions go behind it
+    const size_t offset = buffer->used;
+    struct cfsm_journal_record record;
+    record.size = (uint32_t)size;
+    record.event_id = event_id;
+    record.state = -1;
+    record.status = 0;
+    record.depth = (uint8_t)(writer->depth < UINT8_MAX ? writer->depth : UINT8_MAX);
+    record.writer = (uint16_t)writer->id;
+    memset(buffer->data + offset + sizeof(record) + size, 0, cfsm_journal_padded(size) - size);
+    buffer->used += sizeof(record) + cfsm_journal_padded(size);
+
+    ++writer->depth;
+    enum cfsm_status result = cfsm_process_event(fsm, event_id, event_data);
+    --writer->depth;
+
+    // buffer is still owned by writer, either current or held
+    record.state = nullptr != fsm->current_state ? (int32_t)(fsm->current_state - fsm->states) : -1;
+    record.status = (uint8_t)result;
+    memcpy(buffer->data + offset, &record, sizeof(record));
+
+    if (0 == writer->depth) {
+        cfsm_journal_writer_release_held(writer);
+    }
+    return result;
+}
+
+static void cfsm_replay_record(struct cfsm_state *fsm, const struct cfsm_journal_record *record,
+                               const unsigned char *payload, cfsm_journal_deserialize_f deserialize, void *context,
+                               struct cfsm_replay_report *report) {
+    if (0 != record->depth) {
+        // reproduced by actions of its parent event
+        ++report->events;
+        return;
+    }
+
+    void *event_data = nullptr;
+    if (nullptr != deserialize) {
+        event_data = deserialize(record->event_id, payload, record->size, context);
+    } else if (0 != record->size) {
+        event_data = (void *)payload;
+    }
+
+    const enum cfsm_status status = cfsm_process_event(fsm, record->event_id, event_data);
+    const int32_t state = nullptr != fsm->current_state ? (int32_t)(fsm->current_state - fsm->states) : -1;
+
+    if ((uint8_t)status != record->status || state != record->state) {
+        if (report->first_mismatch < 0) {
+            report->first_mismatch = report->events;
+        }
+        ++report->mismatches;
+    }
+    ++report->events;
+}
+
+bool cfsm_journal_replay(FILE *in, int writer_id, struct cfsm_state *fsm, cfsm_journal_deserialize_f deserialize,
+                         void *context, struct cfsm_replay_report *report) {
+    report->events = 0;
+    report->mismatches = 0;
+    report->first_mismatch = -1;
+
+    unsigned char magic[sizeof(cfsm_journal_magic)];
+    uint32_t version = 0;
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || fread(&version, 1, sizeof(version), in) != sizeof(version) ||
+        0 != memcmp(magic, cfsm_journal_magic, sizeof(magic)) || CFSM_JOURNAL_VERSION != version) {
+        return false;
+    }
+
+    const size_t capacity = CFSM_JOURNAL_BUFFER_SIZE;
+    unsigned char *buffer = malloc(capacity);
+    bool result = nullptr != buffer;
+
+    const int selected = writer_id;
+    size_t filled = 0;
+    while (result) {
+        const size_t n = fread(buffer + filled, 1, capacity - filled, in);
+        if (0 == n) {
+            // leftover bytes mean truncated record
+            result = 0 == filled && !ferror(in);
+            break;
+        }
+        filled += n;
+
+        // run complete records straight from read buffer, incomplete tail is moved to the front
+        size_t position = 0;
+        while (filled - position >= sizeof(struct cfsm_journal_record)) {
+            struct cfsm_journal_record record;
+            memcpy(&record, buffer + position, sizeof(record));
+            const size_t length = sizeof(record) + cfsm_journal_padded(record.size);
+            if (length > capacity) {
+                result = false;
+                break;
+            }
+            if (filled - position < length) {
+                break;
+            }
+            if (-1 == writer_id) {
+                // single writer journal, lock on the first one seen
+                writer_id = record.writer;
+            } else if (writer_id != record.writer && -1 == selected) {
+                // ERROR: records of many writers, machine they drove cannot be told apart
+                result = false;
+                break;
+            }
+            if (writer_id == record.writer) {
+                cfsm_replay_record(fsm, &record, buffer + position + sizeof(record), deserialize, context, report);
+            }
+            position += length;
+        }
+
+        memmove(buffer, buffer + position, filled - position);
+        filled -= position;
+    }
+
+    free(buffer);
+    return result;
+}
@@ -0,0 +1,424 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include "cfsm/cfsm_minimize.h"
+
+#include <stdint.h>
+
+/**
+ * refinable partition, splitting always assigns new index to the smaller half which gives Hopcroft's O(m log n)
+ * (see Valmari & Lehtinen, "Efficient minimization of DFAs with partial transition functions")
+ */
+struct cfsm_partition {
+    int z; // number of sets
+    int w; // number of touched sets
+    int *elements; // elements grouped by set
+    int *location; // position of element within elements
+    int *set; // set of element
+    int *first; // first position of set within elements
+    int *past; // one past last position of set within elements
+    int *marked; // number of marked elements of set, kept at the front of set
+    int *touched; // sets with marked elements
+};
+
+static bool cfsm_partition_alloc(struct cfsm_partition *p, int n) {
+    p->z = 0;
+    p->w = 0;
+    p->elements = malloc(sizeof(int) * (n + 1));
+    p->location = malloc(sizeof(int) * (n + 1));
+    p->set = malloc(sizeof(int) * (n + 1));
+    p->first = malloc(sizeof(int) * (n + 1));
+    p->past = malloc(sizeof(int) * (n + 1));
+    p->marked = calloc(n + 1, sizeof(int));
+    p->touched = malloc(sizeof(int) * (n + 1));
+    return nullptr != p->elements && nullptr != p->location && nullptr != p->set && nullptr != p->first &&
+           nullptr != p->past && nullptr != p->marked && nullptr != p->touched;
+}
+
+static void cfsm_partition_free(struct cfsm_partition *p) {
+    free(p->elements);
+    free(p->location);
+    free(p->set);
+    free(p->first);
+    free(p->past);
+    free(p->marked);
+    free(p->touched);
+}
+
+/**
+ * elements are expected in grouped order, new_group[i] tells whether i-th of them starts a new set
+ */
+static void cfsm_partition_assign(struct cfsm_partition *p, int n, const bool *new_group) {
+    p->z = 0;
+    for (int i = 0; i < n; ++i) {
+        if (0 == i || new_group[i]) {
+            if (p->z > 0) {
+                p->past[p->z - 1] = i;
+            }
+            p->first[p->z++] = i;
+        }
+        p->location[p->elements[i]] = i;
+        p->set[p->elements[i]] = p->z - 1;
+    }
+    if (p->z > 0) {
+        p->past[p->z - 1] = n;
+    }
+}
+
+static void cfsm_partition_mark(struct cfsm_partition *p, int e) {
+    const int s = p->set[e];
+    const int i = p->location[e];
+    const int j = p->first[s] + p->marked[s];
+
+    p->elements[i] = p->elements[j];
+    p->location[p->elements[i]] = i;
+    p->elements[j] = e;
+    p->location[e] = j;
+
+    if (0 == p->marked[s]++) {
+        p->touched[p->w++] = s;
+    }
+}
+
+static void cfsm_partition_split(struct cfsm_partition *p) {
+    while (p->w > 0) {
+        const int s = p->touched[--p->w];
+        const int j = p->first[s] + p->marked[s];
+        if (j == p->past[s]) {
+            p->marked[s] = 0;
+            continue;
+        }
+
+        if (p->marked[s] <= p->past[s] - j) {
+            p->first[p->z] = p->first[s];
+            p->past[p->z] = p->first[s] = j;
+        } else {
+            p->past[p->z] = p->past[s];
+            p->first[p->z] = p->past[s] = j;
+        }
+
+        for (int i = p->first[p->z]; i < p->past[p->z]; ++i) {
+            p->set[p->elements[i]] = p->z;
+        }
+        p->marked[s] = p->marked[p->z++] = 0;
+    }
+}
+
+struct cfsm_minimize_state_key {
+    uintptr_t entry_action;
+    uintptr_t exit_action;
+    uintptr_t defer;
+    int index;
+};
+
+struct cfsm_minimize_edge {
+    int event_id;
+    uintptr_t action;
+    uintptr_t async_action;
+    uintptr_t guard;
+    int tail;
+    int head;
+};
+
+static int cfsm_compare_uintptr(uintptr_t a, uintptr_t b) {
+    return (a > b) - (a < b);
+}
+
+static int cfsm_compare_state_key(const void *lhs, const void *rhs) {
+    const struct cfsm_minimize_state_key *a = lhs;
+    const struct cfsm_minimize_state_key *b = rhs;
+    int result = cfsm_compare_uintptr(a->entry_action, b->entry_action);
+    if (0 == result) {
+        result = cfsm_compare_uintptr(a->exit_action, b->exit_action);
+    }
+    if (0 == result) {
+        result = cfsm_compare_uintptr(a->defer, b->defer);
+    }
+    return result;
+}
+
+static int cfsm_compare_edge_origin(const void *lhs, const void *rhs) {
+    const struct cfsm_minimize_edge *a = lhs;
+    const struct cfsm_minimize_edge *b = rhs;
+    if (a->tail != b->tail) {
+        return (a->tail > b->tail) - (a->tail < b->tail);
+    }
+    return (a->event_id > b->event_id) - (a->event_id < b->event_id);
+}
+
+static int cfsm_compare_edge_label(const void *lhs, const void *rhs) {
+    const struct cfsm_minimize_edge *a = lhs;
+    const struct cfsm_minimize_edge *b = rhs;
+    if (a->event_id != b->event_id) {
+        return (a->event_id > b->event_id) - (a->event_id < b->event_id);
+    }
+    int result = cfsm_compare_uintptr(a->action, b->action);
+    if (0 == result) {
+        result = cfsm_compare_uintptr(a->async_action, b->async_action);
+    }
+    if (0 == result) {
+        result = cfsm_compare_uintptr(a->guard, b->guard);
+    }
+    return result;
+}
+
+static int cfsm_minimize_state_index(struct cfsm_state *fsm, struct cfsm_state *state) {
+    if (state < fsm->states || state >= fsm->states + fsm->num_states) {
+        return -1;
+    }
+    return (int)(state - fsm->states);
+}
+
+static bool cfsm_minimize_collect_edges(struct cfsm_state *fsm, struct cfsm_minimize_edge *edges) {
+    int m = 0;
+    for (int i = 0; i < fsm->num_states; ++i) {
+        for (struct cfsm_transition_list *node = fsm->states[i].transitions; nullptr != node; node = node->next) {
+            struct cfsm_transition *t = node->transition;
+            edges[m].event_id = t->event_id;
+            edges[m].action = (uintptr_t)t->action;
+            edges[m].async_action = (uintptr_t)t->async_action;
+            edges[m].guard = (uintptr_t)t->guard;
+            edges[m].tail = i;
+            edges[m].head = cfsm_minimize_state_index(fsm, t->target);
+            if (edges[m].head < 0) {
+                // ERROR: transition leads outside of the definition
+                return false;
+            }
+            ++m;
+        }
+    }
+
+    // more than one transition per (state, event) makes result depend on evaluation order
+    qsort(edges, m, sizeof(struct cfsm_minimize_edge), cfsm_compare_edge_origin);
+    for (int i = 1; i < m; ++i) {
+        if (0 == cfsm_compare_edge_origin(&edges[i - 1], &edges[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * refine initial partition of states until every block is stable with respect to all labelled transitions
+ */
+static bool cfsm_minimize_refine(struct cfsm_state *fsm, struct cfsm_partition *blocks,
+                                 struct cfsm_minimize_edge *edges, int m) {
+    const int n = fsm->num_states;
+    bool result = false;
+
+    struct cfsm_minimize_state_key *keys = malloc(sizeof(struct cfsm_minimize_state_key) * (n + 1));
+    bool *new_group = malloc(sizeof(bool) * (n + m + 1));
+    int *incoming_first = calloc(n + 2, sizeof(int));
+    int *incoming = malloc(sizeof(int) * (m + 1));
+    struct cfsm_partition cords;
+
+    if (!cfsm_partition_alloc(&cords, m) || nullptr == keys || nullptr == new_group || nullptr == incoming_first ||
+        nullptr == incoming) {
+        goto cleanup;
+    }
+
+    // initial blocks: states with the same entry, exit and defer actions
+    for (int i = 0; i < n; ++i) {
+        keys[i].entry_action = (uintptr_t)fsm->states[i].entry_action;
+        keys[i].exit_action = (uintptr_t)fsm->states[i].exit_action;
+        keys[i].defer = (uintptr_t)fsm->states[i].defer;
+        keys[i].index = i;
+    }
+    qsort(keys, n, sizeof(struct cfsm_minimize_state_key), cfsm_compare_state_key);
+    for (int i = 0; i < n; ++i) {
+        blocks->elements[i] = keys[i].index;
+        new_group[i] = i > 0 && 0 != cfsm_compare_state_key(&keys[i - 1], &keys[i]);
+    }
+    cfsm_partition_assign(blocks, n, new_group);
+
+    // initial cords: transitions with the same event, actions and guard
+    qsort(edges, m, sizeof(struct cfsm_minimize_edge), cfsm_compare_edge_label);
+    for (int i = 0; i < m; ++i) {
+        cords.elements[i] = i;
+        new_group[i] = i > 0 && 0 != cfsm_compare_edge_label(&edges[i - 1], &edges[i]);
+    }
+    cfsm_partition_assign(&cords, m, new_group);
+
+    // transitions grouped by target state
+    for (int t = 0; t < m; ++t) {
+        ++incoming_first[edges[t].head + 1];
+    }
+    for (int i = 0; i < n; ++i) {
+        incoming_first[i + 1] += incoming_first[i];
+    }
+    for (int t = 0; t < m; ++t) {
+        incoming[incoming_first[edges[t].head]++] = t;
+    }
+    for (int i = n; i > 0; --i) {
+        incoming_first[i] = incoming_first[i - 1];
+    }
+    incoming_first[0] = 0;
+
+    // every block but the first one is a splitter initially
+    int b = 1;
+    int c = 0;
+    while (c < cords.z) {
+        for (int i = cords.first[c]; i < cords.past[c]; ++i) {
+            cfsm_partition_mark(blocks, edges[cords.elements[i]].tail);
+        }
+        cfsm_partition_split(blocks);
+        ++c;
+
+        while (b < blocks->z) {
+            for (int i = blocks->first[b]; i < blocks->past[b]; ++i) {
+                const int state = blocks->elements[i];
+                for (int j = incoming_first[state]; j < incoming_first[state + 1]; ++j) {
+                    cfsm_partition_mark(&cords, incoming[j]);
+                }
+            }
+            cfsm_partition_split(&cords);
+            ++b;
+        }
+    }
+    result = true;
+
+cleanup:
+    cfsm_partition_free(&cords);
+    free(keys);
+    free(new_group);
+    free(incoming_first);
+    free(incoming);
+    return result;
+}
+
+static bool cfsm_minimize_build(struct cfsm_state *fsm, struct cfsm_partition *blocks,
+                                struct cfsm_minimized *minimized) {
+    const int n = fsm->num_states;
+
+    int *block_map = malloc(sizeof(int) * (blocks->z + 1));
+    int *representative = malloc(sizeof(int) * (blocks->z + 1));
+    minimized->state_map = malloc(sizeof(int) * (n + 1));
+    minimized->states = malloc(sizeof(struct cfsm_state) * (blocks->z + 1));
+    if (nullptr == block_map || nullptr == representative || nullptr == minimized->state_map ||
+        nullptr == minimized->states) {
+        free(block_map);
+        free(representative);
+        return false;
+    }
+
+    // number classes in order of their first member within original definition
+    for (int s = 0; s < blocks->z; ++s) {
+        block_map[s] = -1;
+    }
+    minimized->num_states = 0;
+    minimized->num_transitions = 0;
+    for (int i = 0; i < n; ++i) {
+        const int s = blocks->set[i];
+        if (block_map[s] < 0) {
+            representative[minimized->num_states] = i;
+            block_map[s] = minimized->num_states++;
+            minimized->num_transitions += fsm->states[i].num_transitions;
+        }
+        minimized->state_map[i] = block_map[s];
+    }
+    free(block_map);
+
+    minimized->transitions = malloc(sizeof(struct cfsm_transition) * (minimized->num_transitions + 1));
+    if (nullptr == minimized->transitions) {
+        free(representative);
+        return false;
+    }
+
+    for (int k = 0; k < minimized->num_states; ++k) {
+        struct cfsm_state *original = &fsm->states[representative[k]];
+        struct cfsm_state *state = cfsm_init_state(&minimized->states[k], original->name);
+        state->entry_action = original->entry_action;
+        state->exit_action = original->exit_action;
+        state->defer = original->defer;
+    }
+
+    cfsm_init_state(&minimized->fsm, fsm->name);
+    minimized->fsm.entry_action = fsm->entry_action;
+    minimized->fsm.exit_action = fsm->exit_action;
+    minimized->fsm.defer = fsm->defer;
+    cfsm_init(&minimized->fsm, minimized->num_states, minimized->states,
+              nullptr != fsm->initial_state
+                      ? &minimized->states[minimized->state_map[cfsm_minimize_state_index(fsm, fsm->initial_state)]]
+                      : nullptr);
+
+    int t = 0;
+    for (int k = 0; k < minimized->num_states; ++k) {
+        struct cfsm_state *original = &fsm->states[representative[k]];
+        for (struct cfsm_transition_list *node = original->transitions; nullptr != node; node = node->next) {
+            struct cfsm_transition *ot = node->transition;
+            struct cfsm_state *target = &minimized->states[minimized->state_map[cfsm_minimize_state_index(fsm, ot->target)]];
+            cfsm_init_transition_ag(&minimized->transitions[t], &minimized->states[k], target, ot->event_id,
+                                    ot->action, ot->guard);
+            cfsm_transition_set_async_action(&minimized->transitions[t], ot->async_action);
+            cfsm_add_transition(&minimized->fsm, &minimized->transitions[t]);
+            ++t;
+        }
+    }
+
+    free(representative);
+    return true;
+}
+
+bool cfsm_minimize(struct cfsm_state *fsm, struct cfsm_minimized *minimized) {
+    minimized->num_states = 0;
+    minimized->states = nullptr;
+    minimized->num_transitions = 0;
+    minimized->transitions = nullptr;
+    minimized->original_states = fsm->states;
+    minimized->num_original_states = fsm->num_states;
+    minimized->state_map = nullptr;
+    cfsm_init_state(&minimized->fsm, fsm->name);
+
+    if (nullptr != fsm->current_state) {
+        // WARN: minimization of running state machine is prohibited!
+        return false;
+    }
+
+    int m = 0;
+    for (int i = 0; i < fsm->num_states; ++i) {
+        if (0 != fsm->states[i].num_states) {
+            // ERROR: only flat machines can be minimized
+            return false;
+        }
+        m += fsm->states[i].num_transitions;
+    }
+    if (nullptr != fsm->initial_state && cfsm_minimize_state_index(fsm, fsm->initial_state) < 0) {
+        return false;
+    }
+
+    struct cfsm_minimize_edge *edges = malloc(sizeof(struct cfsm_minimize_edge) * (m + 1));
+    struct cfsm_partition blocks;
+    bool result = cfsm_partition_alloc(&blocks, fsm->num_states) && nullptr != edges &&
+                  cfsm_minimize_collect_edges(fsm, edges) && cfsm_minimize_refine(fsm, &blocks, edges, m) &&
+                  cfsm_minimize_build(fsm, &blocks, minimized);
+
+    cfsm_partition_free(&blocks);
+    free(edges);
+    if (!result) {
+        cfsm_minimized_destroy(minimized);
+    }
+    return result;
+}
+
+void cfsm_minimized_destroy(struct cfsm_minimized *minimized) {
+    cfsm_state_destroy(&minimized->fsm);
+
+    free(minimized->states);
+    free(minimized->transitions);
+    free(minimized->state_map);
+
+    minimized->states = nullptr;
+    minimized->transitions = nullptr;
+    minimized->state_map = nullptr;
+    minimized->num_states = 0;
+    minimized->num_transitions = 0;
+}
+
+struct cfsm_state *cfsm_minimized_state(struct cfsm_minimized *minimized, struct cfsm_state *original) {
+    if (original < minimized->original_states ||
+        original >= minimized->original_states + minimized->num_original_states) {
+        return nullptr;
+    }
+    return &minimized->states[minimized->state_map[original - minimized->original_states]];
+}
@@ -0,0 +1,143 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include "cfsm/cfsm_priority.h"
+
+static int cfsm_compare_rule(const void *lhs, const void *rhs) {
+    const struct cfsm_priority_rule *a = lhs;
+    const struct cfsm_priority_rule *b = rhs;
+    return (a->event_id > b->event_id) - (a->event_id < b->event_id);
+}
+
+/**
+ * @return index of rule for event_id, -1 if there is none
+ */
+static int cfsm_priority_find_rule(struct cfsm_priority_queue *queue, int event_id) {
+    if (0 == queue->num_rules) {
+        return -1;
+    }
+    struct cfsm_priority_rule key;
+    key.event_id = event_id;
+    const struct cfsm_priority_rule *rule =
+            bsearch(&key, queue->rules, queue->num_rules, sizeof(struct cfsm_priority_rule), cfsm_compare_rule);
+    return nullptr != rule ? (int)(rule - queue->rules) : -1;
+}
+
+bool cfsm_priority_queue_init(struct cfsm_priority_queue *queue, const struct cfsm_priority_rule *rules,
+                              int num_rules, int *queued, int num_classes, struct cfsm_event **storage,
+                              int capacity) {
+    if (num_classes < 1 || num_classes > CFSM_PRIORITY_MAX_CLASSES || capacity < 1 || num_rules < 0) {
+        return false;
+    }
+    for (int i = 0; i < num_rules; ++i) {
+        if (rules[i].priority < 0 || rules[i].priority >= num_classes) {
+            // ERROR: rule refers to class that does not exist
+            return false;
+        }
+        if (0 != i && rules[i - 1].event_id >= rules[i].event_id) {
+            // ERROR: rules are not sorted or event id repeats
+            return false;
+        }
+        queued[i] = -1;
+    }
+
+    queue->rules = rules;
+    queue->num_rules = num_rules;
+    queue->queued = queued;
+    queue->num_classes = num_classes;
+    for (int i = 0; i < num_classes; ++i) {
+        queue->rings[i].slots = storage + i * capacity;
+        queue->rings[i].capacity = capacity;
+        queue->rings[i].head = 0;
+        queue->rings[i].size = 0;
+    }
+    queue->dropped = 0;
+    queue->coalesced = 0;
+    return true;
+}
+
+void cfsm_priority_queue_clear(struct cfsm_priority_queue *queue) {
+    struct cfsm_event *event = nullptr;
+    while (nullptr != (event = cfsm_priority_queue_pop(queue))) {
+        cfsm_event_release(event);
+    }
+}
+
+bool cfsm_priority_queue_push(struct cfsm_priority_queue *queue, struct cfsm_event *event) {
+    if (nullptr == event) {
+        // WARN: envelope allocation failed upstream
+        ++queue->dropped;
+        return false;
+    }
+
+    const int r = cfsm_priority_find_rule(queue, event->event_id);
+    const struct cfsm_priority_rule *rule = r >= 0 ? &queue->rules[r] : nullptr;
+    struct cfsm_priority_ring *ring = &queue->rings[nullptr != rule ? rule->priority : queue->num_classes - 1];
+
+    if (nullptr != rule && -1 != queue->queued[r]) {
+        if (cfsm_coalesce_keep_latest == rule->coalesce) {
+            cfsm_event_release(ring->slots[queue->queued[r]]);
+            ring->slots[queue->queued[r]] = event;
+            ++queue->coalesced;
+            return true;
+        }
+        if (cfsm_coalesce_drop_duplicates == rule->coalesce) {
+            cfsm_event_release(event);
+            ++queue->coalesced;
+            return false;
+        }
+    }
+
+    if (ring->size == ring->capacity) {
+        cfsm_event_release(event);
+        ++queue->dropped;
+        return false;
+    }
+
+    const int slot = (ring->head + ring->size) % ring->capacity;
+    ring->slots[slot] = event;
+    ++ring->size;
+    if (nullptr != rule && cfsm_coalesce_none != rule->coalesce) {
+        queue->queued[r] = slot;
+    }
+    return true;
+}
+
+struct cfsm_event *cfsm_priority_queue_pop(struct cfsm_priority_queue *queue) {
+    for (int i = 0; i < queue->num_classes; ++i) {
+        struct cfsm_priority_ring *ring = &queue->rings[i];
+        if (0 == ring->size) {
+            continue;
+        }
+
+        struct cfsm_event *event = ring->slots[ring->head];
+        const int r = cfsm_priority_find_rule(queue, event->event_id);
+        if (r >= 0 && ring->head == queue->queued[r]) {
+            queue->queued[r] = -1;
+        }
+        ring->head = (ring->head + 1) % ring->capacity;
+        --ring->size;
+        return event;
+    }
+    return nullptr;
+}
+
+int cfsm_priority_queue_size(struct cfsm_priority_queue *queue) {
+    int size = 0;
+    for (int i = 0; i < queue->num_classes; ++i) {
+        size += queue->rings[i].size;
+    }
+    return size;
+}
+
+int cfsm_priority_queue_dispatch(struct cfsm_priority_queue *queue, struct cfsm_state *fsm, int max_events) {
+    int processed = 0;
+    struct cfsm_event *event = nullptr;
+    while ((max_events < 0 || processed < max_events) && !cfsm_is_in_transition(fsm) &&
+           nullptr != (event = cfsm_priority_queue_pop(queue))) {
+        cfsm_process_event_sink(fsm, event);
+        ++processed;
+    }
+    return processed;
+}
@@ -0,0 +1,518 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include "cfsm/cfsm_snapshot.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define CFSM_SNAPSHOT_BUFFER_SIZE (1 << 16)
+
+static const unsigned char cfsm_snapshot_magic[4] = {'C', 'F', 'S', 'M'};
+
+enum cfsm_snapshot_kind {
+    cfsm_snapshot_kind_machines,
+    cfsm_snapshot_kind_bulk
+};
+
+/**
+ * snapshot is written as frames: 4 byte little endian length followed by that many bytes,
+ * empty frame terminates it. Reader never consumes stream past the terminator, so that stream
+ * may carry more data after snapshot and needs no seeking (pipes, sockets).
+ */
+static void cfsm_frame_length_encode(unsigned char *bytes, uint32_t length) {
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = (unsigned char)(length >> (8 * i));
+    }
+}
+
+static bool cfsm_frame_length_read(FILE *in, uint32_t *length) {
+    unsigned char bytes[4];
+    if (fread(bytes, 1, sizeof(bytes), in) != sizeof(bytes)) {
+        return false;
+    }
+    *length = 0;
+    for (int i = 0; i < 4; ++i) {
+        *length |= (uint32_t)bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+/**
+ * buffered writer, errors are sticky and reported once at the end
+ */
+struct cfsm_snapshot_writer {
+    FILE *out;
+    bool ok;
+    size_t used;
+    unsigned char buffer[CFSM_SNAPSHOT_BUFFER_SIZE];
+};
+
+static void cfsm_writer_frame(struct cfsm_snapshot_writer *w, const void *data, size_t size) {
+    unsigned char length[4];
+    cfsm_frame_length_encode(length, (uint32_t)size);
+    if (w->ok && (fwrite(length, 1, sizeof(length), w->out) != sizeof(length) ||
+                  (0 != size && fwrite(data, 1, size, w->out) != size))) {
+        w->ok = false;
+    }
+}
+
+static void cfsm_writer_flush(struct cfsm_snapshot_writer *w) {
+    if (w->used != 0) {
+        cfsm_writer_frame(w, w->buffer, w->used);
+    }
+    w->used = 0;
+}
+
+static struct cfsm_snapshot_writer *cfsm_writer_open(FILE *out) {
+    struct cfsm_snapshot_writer *w = malloc(sizeof(struct cfsm_snapshot_writer));
+    if (nullptr != w) {
+        w->out = out;
+        w->ok = true;
+        w->used = 0;
+    }
+    return w;
+}
+
+static bool cfsm_writer_close(struct cfsm_snapshot_writer *w) {
+    cfsm_writer_flush(w);
+    cfsm_writer_frame(w, nullptr, 0);
+    bool result = w->ok && 0 == fflush(w->out);
+    free(w);
+    return result;
+}
+
+static void cfsm_writer_bytes(struct cfsm_snapshot_writer *w, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    while (size != 0) {
+        if (w->used == CFSM_SNAPSHOT_BUFFER_SIZE) {
+            cfsm_writer_flush(w);
+        }
+        size_t chunk = CFSM_SNAPSHOT_BUFFER_SIZE - w->used;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(w->buffer + w->used, bytes, chunk);
+        w->used += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+static void cfsm_writer_varint(struct cfsm_snapshot_writer *w, uint64_t value) {
+    if (CFSM_SNAPSHOT_BUFFER_SIZE - w->used < 10) {
+        cfsm_writer_flush(w);
+    }
+    while (value >= 0x80) {
+        w->buffer[w->used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    w->buffer[w->used++] = (unsigned char)value;
+}
+
+static void cfsm_writer_zigzag(struct cfsm_snapshot_writer *w, int value) {
+    cfsm_writer_varint(w, ((uint64_t)(uint32_t)value << 1) ^ (uint64_t)(uint32_t)(value >> 31));
+}
+
+struct cfsm_snapshot_reader {
+    FILE *in;
+    bool ok;
+    bool ended; // terminating frame consumed
+    size_t used;
+    size_t size;
+    unsigned char buffer[CFSM_SNAPSHOT_BUFFER_SIZE];
+};
+
+/**
+ * read next frame
+ */
+static void cfsm_reader_next_frame(struct cfsm_snapshot_reader *r) {
+    uint32_t length = 0;
+    r->used = 0;
+    r->size = 0;
+    if (r->ended || !cfsm_frame_length_read(r->in, &length) || length > CFSM_SNAPSHOT_BUFFER_SIZE) {
+        r->ok = false;
+        return;
+    }
+    if (0 == length) {
+        r->ended = true;
+        return;
+    }
+    if (fread(r->buffer, 1, length, r->in) != length) {
+        r->ok = false;
+        return;
+    }
+    r->size = length;
+}
+
+static bool cfsm_reader_fill(struct cfsm_snapshot_reader *r) {
+    if (r->ok && r->used == r->size) {
+        cfsm_reader_next_frame(r);
+        if (0 == r->size) {
+            // snapshot ended before all machines were read
+            r->ok = false;
+        }
+    }
+    return r->ok;
+}
+
+static struct cfsm_snapshot_reader *cfsm_reader_open(FILE *in) {
+    struct cfsm_snapshot_reader *r = malloc(sizeof(struct cfsm_snapshot_reader));
+    if (nullptr != r) {
+        r->in = in;
+        r->ok = true;
+        r->ended = false;
+        r->used = 0;
+        r->size = 0;
+    }
+    return r;
+}
+
+static bool cfsm_reader_close(struct cfsm_snapshot_reader *r) {
+    // all data has to be consumed and terminating frame has to follow
+    if (r->ok && r->used == r->size) {
+        cfsm_reader_next_frame(r);
+    }
+    if (r->ok && !r->ended) {
+        // ERROR: snapshot holds more data than restored machines
+        r->ok = false;
+    }
+    bool result = r->ok;
+    free(r);
+    return result;
+}
+
+static void cfsm_reader_bytes(struct cfsm_snapshot_reader *r, void *data, size_t size) {
+    unsigned char *bytes = data;
+    while (size != 0 && cfsm_reader_fill(r)) {
+        size_t chunk = r->size - r->used;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(bytes, r->buffer + r->used, chunk);
+        r->used += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+static uint64_t cfsm_reader_varint(struct cfsm_snapshot_reader *r) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && cfsm_reader_fill(r); shift += 7) {
+        const unsigned char byte = r->buffer[r->used++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (0 == (byte & 0x80)) {
+            return value;
+        }
+    }
+    r->ok = false;
+    return 0;
+}
+
+static int cfsm_reader_zigzag(struct cfsm_snapshot_reader *r) {
+    const uint32_t value = (uint32_t)cfsm_reader_varint(r);
+    return (int)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+static void cfsm_write_header(struct cfsm_snapshot_writer *w, enum cfsm_snapshot_kind kind, int count) {
+    const unsigned char version[2] = {CFSM_SNAPSHOT_VERSION, (unsigned char)kind};
+    cfsm_writer_bytes(w, cfsm_snapshot_magic, sizeof(cfsm_snapshot_magic));
+    cfsm_writer_bytes(w, version, sizeof(version));
+    cfsm_writer_varint(w, (uint64_t)count);
+}
+
+static bool cfsm_read_header(struct cfsm_snapshot_reader *r, enum cfsm_snapshot_kind kind, int count) {
+    unsigned char magic[sizeof(cfsm_snapshot_magic)];
+    unsigned char version[2];
+    cfsm_reader_bytes(r, magic, sizeof(magic));
+    cfsm_reader_bytes(r, version, sizeof(version));
+    const uint64_t snapshot_count = cfsm_reader_varint(r);
+    return r->ok && 0 == memcmp(magic, cfsm_snapshot_magic, sizeof(magic)) && CFSM_SNAPSHOT_VERSION == version[0] &&
+           kind == version[1] && (uint64_t)count == snapshot_count;
+}
+
+static void cfsm_write_queue(struct cfsm_snapshot_writer *w, struct cfsm_event_queue *queue) {
+    cfsm_writer_varint(w, (uint64_t)queue->size);
+    for (struct cfsm_event *event = queue->head; nullptr != event; event = event->next) {
+        const size_t size = nullptr != event->event_data ? event->size : 0;
+        cfsm_writer_zigzag(w, event->event_id);
+        cfsm_writer_varint(w, size);
+        cfsm_writer_bytes(w, event->event_data, size);
+    }
+}
+
+static void cfsm_write_machine(struct cfsm_snapshot_writer *w, struct cfsm_state *fsm) {
+    if (cfsm_is_in_transition(fsm)) {
+        // ERROR: asynchronous transition in flight cannot be captured
+        w->ok = false;
+        return;
+    }
+
+    const int current = nullptr != fsm->current_state ? (int)(fsm->current_state - fsm->states) : -1;
+    cfsm_writer_varint(w, (uint64_t)(current + 1));
+
+    for (int i = 0; i < fsm->num_states; ++i) {
+        if (0 != fsm->states[i].num_states) {
+            cfsm_write_machine(w, &fsm->states[i]);
+        }
+    }
+
+    if (nullptr != fsm->runtime) {
+        cfsm_write_queue(w, &fsm->runtime->deferred);
+        cfsm_write_queue(w, &fsm->runtime->inbox);
+    } else {
+        cfsm_writer_varint(w, 0);
+        cfsm_writer_varint(w, 0);
+    }
+}
+
+static void cfsm_read_queue(struct cfsm_snapshot_reader *r, struct cfsm_event_queue *queue,
+                            struct cfsm_event_pool *pool) {
+    cfsm_event_queue_clear(queue);
+
+    const uint64_t count = cfsm_reader_varint(r);
+    for (uint64_t i = 0; i < count && r->ok; ++i) {
+        const int event_id = cfsm_reader_zigzag(r);
+        const uint64_t size = cfsm_reader_varint(r);
+        if (size > SIZE_MAX || !r->ok) {
+            r->ok = false;
+            return;
+        }
+
+        struct cfsm_event *event = cfsm_event_alloc(pool, event_id, (size_t)size);
+        if (nullptr == event) {
+            r->ok = false;
+            return;
+        }
+        cfsm_reader_bytes(r, event->event_data, (size_t)size);
+        cfsm_event_queue_push(queue, event);
+    }
+}
+
+/**
+ * queued events of single machine, kept aside only for machines having any
+ */
+struct cfsm_restored_queues {
+    struct cfsm_restored_queues *next;
+    int machine; // index of owning machine
+    struct cfsm_event_queue deferred;
+    struct cfsm_event_queue inbox;
+};
+
+/**
+ * decoded runtime state, applied only once whole snapshot is read and validated
+ */
+struct cfsm_restored {
+    int *currents; // current state index + 1 per machine, in snapshot order
+    int num_machines;
+    int capacity;
+    struct cfsm_restored_queues *queues_head; // in snapshot order of their machines
+    struct cfsm_restored_queues *queues_tail;
+};
+
+static void cfsm_read_machine(struct cfsm_snapshot_reader *r, struct cfsm_state *fsm,
+                              struct cfsm_restored *restored, struct cfsm_event_pool *pool) {
+    const uint64_t current = cfsm_reader_varint(r);
+    if (!r->ok || current > (uint64_t)fsm->num_states) {
+        // ERROR: snapshot does not match machine definition
+        r->ok = false;
+        return;
+    }
+
+    if (restored->num_machines == restored->capacity) {
+        const int capacity = 2 * restored->capacity;
+        int *currents = realloc(restored->currents, sizeof(int) * capacity);
+        if (nullptr == currents) {
+            r->ok = false;
+            return;
+        }
+        restored->currents = currents;
+        restored->capacity = capacity;
+    }
+    const int machine = restored->num_machines++;
+    restored->currents[machine] = (int)current;
+
+    for (int i = 0; i < fsm->num_states && r->ok; ++i) {
+        if (0 != fsm->states[i].num_states) {
+            cfsm_read_machine(r, &fsm->states[i], restored, pool);
+        }
+    }
+
+    struct cfsm_event_queue deferred;
+    struct cfsm_event_queue inbox;
+    cfsm_event_queue_init(&deferred);
+    cfsm_event_queue_init(&inbox);
+    cfsm_read_queue(r, &deferred, pool);
+    cfsm_read_queue(r, &inbox, pool);
+    if (0 == deferred.size && 0 == inbox.size) {
+        return;
+    }
+
+    // runtime is allocated here, so that applying cannot fail
+    struct cfsm_restored_queues *queues = malloc(sizeof(struct cfsm_restored_queues));
+    if (!r->ok || nullptr == queues || nullptr == cfsm_get_runtime(fsm)) {
+        r->ok = false;
+        free(queues);
+        cfsm_event_queue_clear(&deferred);
+        cfsm_event_queue_clear(&inbox);
+        return;
+    }
+    queues->next = nullptr;
+    queues->machine = machine;
+    queues->deferred = deferred;
+    queues->inbox = inbox;
+    if (nullptr == restored->queues_tail) {
+        restored->queues_head = queues;
+    } else {
+        restored->queues_tail->next = queues;
+    }
+    restored->queues_tail = queues;
+}
+
+/**
+ * @param machine index of next machine in snapshot order
+ */
+static void cfsm_apply_machine(struct cfsm_state *fsm, struct cfsm_restored *restored, int *machine) {
+    const int index = (*machine)++;
+    const int current = restored->currents[index];
+    fsm->current_state = 0 != current ? &fsm->states[current - 1] : nullptr;
+
+    for (int i = 0; i < fsm->num_states; ++i) {
+        if (0 != fsm->states[i].num_states) {
+            cfsm_apply_machine(&fsm->states[i], restored, machine);
+        }
+    }
+
+    struct cfsm_runtime *runtime = fsm->runtime;
+    if (nullptr == runtime) {
+        return;
+    }
+
+    // transition in flight is abandoned, restored machine settles in snapshotted state
+    struct cfsm_pending *pending = &runtime->pending;
+    cfsm_event_release(pending->event);
+    pending->transition = nullptr;
+    pending->event = nullptr;
+    pending->event_id = 0;
+    pending->event_data = nullptr;
+    pending->completed = nullptr;
+    pending->drain = false;
+
+    cfsm_event_queue_clear(&runtime->deferred);
+    cfsm_event_queue_clear(&runtime->inbox);
+
+    // queues were read in the same post-order as machines are applied
+    struct cfsm_restored_queues *queues = restored->queues_head;
+    if (nullptr != queues && index == queues->machine) {
+        runtime->deferred = queues->deferred;
+        runtime->inbox = queues->inbox;
+        restored->queues_head = queues->next;
+        free(queues);
+    }
+}
+
+bool cfsm_snapshot(FILE *out, struct cfsm_state **fsms, int count) {
+    struct cfsm_snapshot_writer *w = cfsm_writer_open(out);
+    if (nullptr == w) {
+        return false;
+    }
+
+    cfsm_write_header(w, cfsm_snapshot_kind_machines, count);
+    for (int i = 0; i < count; ++i) {
+        cfsm_write_machine(w, fsms[i]);
+    }
+    return cfsm_writer_close(w);
+}
+
+bool cfsm_restore(FILE *in, struct cfsm_state **fsms, int count, struct cfsm_event_pool *pool) {
+    struct cfsm_restored restored;
+    restored.num_machines = 0;
+    restored.capacity = count > 0 ? count : 1;
+    restored.currents = malloc(sizeof(int) * restored.capacity);
+    restored.queues_head = nullptr;
+    restored.queues_tail = nullptr;
+
+    struct cfsm_snapshot_reader *r = cfsm_reader_open(in);
+    if (nullptr == r || nullptr == restored.currents) {
+        free(restored.currents);
+        if (nullptr != r) {
+            cfsm_reader_close(r);
+        }
+        return false;
+    }
+
+    if (cfsm_read_header(r, cfsm_snapshot_kind_machines, count)) {
+        for (int i = 0; i < count && r->ok; ++i) {
+            cfsm_read_machine(r, fsms[i], &restored, pool);
+        }
+    } else {
+        r->ok = false;
+    }
+
+    const bool result = cfsm_reader_close(r);
+    if (result) {
+        int machine = 0;
+        for (int i = 0; i < count; ++i) {
+            cfsm_apply_machine(fsms[i], &restored, &machine);
+        }
+    }
+
+    // nothing is left over after successful apply
+    while (nullptr != restored.queues_head) {
+        struct cfsm_restored_queues *queues = restored.queues_head;
+        restored.queues_head = queues->next;
+        cfsm_event_queue_clear(&queues->deferred);
+        cfsm_event_queue_clear(&queues->inbox);
+        free(queues);
+    }
+    free(restored.currents);
+    return result;
+}
+
+bool cfsm_bulk_snapshot(FILE *out, struct cfsm_bulk *bulk, const int *states, int count) {
+    struct cfsm_snapshot_writer *w = cfsm_writer_open(out);
+    if (nullptr == w) {
+        return false;
+    }
+
+    cfsm_write_header(w, cfsm_snapshot_kind_bulk, count);
+    cfsm_writer_varint(w, (uint64_t)bulk->num_states);
+    for (int i = 0; i < count; ++i) {
+        cfsm_writer_varint(w, (uint64_t)(states[i] + 1));
+    }
+    return cfsm_writer_close(w);
+}
+
+bool cfsm_bulk_restore(FILE *in, struct cfsm_bulk *bulk, int *states, int count) {
+    struct cfsm_snapshot_reader *r = cfsm_reader_open(in);
+    int *restored = malloc(sizeof(int) * (count > 0 ? count : 1));
+    if (nullptr == r || nullptr == restored) {
+        free(restored);
+        if (nullptr != r) {
+            cfsm_reader_close(r);
+        }
+        return false;
+    }
+
+    if (cfsm_read_header(r, cfsm_snapshot_kind_bulk, count) && (uint64_t)bulk->num_states == cfsm_reader_varint(r)) {
+        for (int i = 0; i < count && r->ok; ++i) {
+            const uint64_t state = cfsm_reader_varint(r);
+            if (state > (uint64_t)bulk->num_states) {
+                // ERROR: snapshot does not match machine definition
+                r->ok = false;
+                break;
+            }
+            restored[i] = (int)state - 1;
+        }
+    } else {
+        r->ok = false;
+    }
+
+    const bool result = cfsm_reader_close(r);
+    if (result) {
+        memcpy(states, restored, sizeof(int) * count);
+    }
+    free(restored);
+    return result;
+}
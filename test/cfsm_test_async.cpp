@@ -0,0 +1,241 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_bulk.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <vector>
+
+using namespace ::testing;
+
+struct AsyncActionMock {
+    MOCK_CONST_METHOD5(call, void(struct cfsm_state *fsm, struct cfsm_state *origin, struct cfsm_state *next,
+                                  int event_id, void *event_data));
+};
+
+struct AsyncEntryActionMock {
+    MOCK_CONST_METHOD3(call, void(struct cfsm_state *state, int event_id, void *event_data));
+};
+
+std::unique_ptr<AsyncActionMock> g_async_action;
+void asyncAction(struct cfsm_state *fsm, struct cfsm_state *origin, struct cfsm_state *next, int event_id,
+                 void *event_data) {
+    g_async_action->call(fsm, origin, next, event_id, event_data);
+}
+
+std::unique_ptr<AsyncEntryActionMock> g_async_entry;
+void asyncEntryAction(struct cfsm_state *state, int event_id, void *event_data) {
+    g_async_entry->call(state, event_id, event_data);
+}
+
+void suspendingAction(struct cfsm_state *, struct cfsm_state *, struct cfsm_state *, int, void *) {}
+
+bool asyncDeferAll(struct cfsm_state *, int, void *) {
+    return true;
+}
+
+/**
+ * idle -> busy on event 1 (asynchronous), busy -> done on event 2
+ */
+struct AsyncMachine {
+    explicit AsyncMachine(cfsm_async_action_f action = suspendingAction) {
+        cfsm_init_state(&states[0], "idle");
+        cfsm_init_state(&states[1], "busy");
+        cfsm_init_state(&states[2], "done");
+        cfsm_init(&fsm, 3, states, &states[0]);
+
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[0], &states[0], &states[1], 1));
+        cfsm_transition_set_async_action(&t[0], action);
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[1], &states[1], &states[2], 2));
+    }
+
+    ~AsyncMachine() {
+        if (!cfsm_is_in_transition(&fsm)) {
+            cfsm_stop(&fsm, 0, nullptr);
+        }
+        cfsm_state_destroy(&fsm);
+    }
+
+    cfsm_state states[3]{};
+    cfsm_state fsm{};
+    cfsm_transition t[2]{};
+};
+
+struct cfsm_test_async : Test {
+    cfsm_test_async() {
+        g_async_action = std::make_unique<StrictMock<AsyncActionMock>>();
+        g_async_entry = std::make_unique<StrictMock<AsyncEntryActionMock>>();
+    }
+
+    ~cfsm_test_async() override {
+        g_async_entry.reset(nullptr);
+        g_async_action.reset(nullptr);
+    }
+};
+
+TEST_F(cfsm_test_async, cfsm_test_async_action_keeps_fsm_in_transition_until_completed) {
+    AsyncMachine machine(asyncAction);
+    machine.states[1].entry_action = asyncEntryAction;
+    int payload = 42;
+
+    EXPECT_CALL(*g_async_action, call(&machine.fsm, &machine.states[0], &machine.states[1], 1, &payload));
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event(&machine.fsm, 1, &payload));
+    ASSERT_TRUE(cfsm_is_in_transition(&machine.fsm));
+    ASSERT_EQ(&machine.states[0], machine.fsm.current_state);
+
+    EXPECT_CALL(*g_async_entry, call(&machine.states[1], 1, &payload));
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_FALSE(cfsm_is_in_transition(&machine.fsm));
+    ASSERT_EQ(&machine.states[1], machine.fsm.current_state);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_events_are_queued_during_transition) {
+    AsyncMachine machine;
+
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event(&machine.fsm, 1, nullptr));
+    ASSERT_EQ(cfsm_status_queued, cfsm_process_event(&machine.fsm, 2, nullptr));
+
+    cfsm_event *e = cfsm_event_alloc(nullptr, 2, 0);
+    ASSERT_EQ(cfsm_status_queued, cfsm_process_event_sink(&machine.fsm, e));
+    ASSERT_EQ(2, cfsm_get_runtime(&machine.fsm)->inbox.size);
+    ASSERT_EQ(0, cfsm_dispatch(&machine.fsm)) << "inbox is not drained while in transition";
+
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_EQ(&machine.states[2], machine.fsm.current_state);
+    ASSERT_EQ(0, cfsm_get_runtime(&machine.fsm)->inbox.size);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_completion_from_within_action_is_synchronous) {
+    AsyncMachine machine(asyncAction);
+
+    EXPECT_CALL(*g_async_action, call(_, _, _, 1, _)).WillOnce(Invoke(
+            [](struct cfsm_state *fsm, struct cfsm_state *, struct cfsm_state *, int, void *) {
+                cfsm_complete_transition(fsm);
+            }));
+    cfsm_event *e = cfsm_event_alloc(nullptr, 1, 16);
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event_sink(&machine.fsm, e));
+    ASSERT_FALSE(cfsm_is_in_transition(&machine.fsm));
+    ASSERT_EQ(&machine.states[1], machine.fsm.current_state);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_event_queued_by_action_completing_inline_is_processed) {
+    AsyncMachine machine(asyncAction);
+    int payload = 42;
+
+    EXPECT_CALL(*g_async_action, call(_, _, _, 1, _)).WillOnce(Invoke(
+            [](struct cfsm_state *fsm, struct cfsm_state *, struct cfsm_state *, int, void *) {
+                ASSERT_EQ(cfsm_status_queued, cfsm_process_event(fsm, 2, nullptr));
+                cfsm_complete_transition(fsm);
+            }));
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event(&machine.fsm, 1, &payload));
+    ASSERT_EQ(&machine.states[2], machine.fsm.current_state);
+    ASSERT_EQ(0, cfsm_get_runtime(&machine.fsm)->inbox.size);
+    ASSERT_EQ(nullptr, cfsm_get_runtime(&machine.fsm)->pending.event_data);
+}
+
+cfsm_state *g_entering_fsm = nullptr;
+enum cfsm_status g_entry_status = cfsm_status_not_ok;
+
+void startingEntryAction(struct cfsm_state *, int, void *) {
+    g_entry_status = cfsm_process_event_sink(g_entering_fsm, cfsm_event_alloc(nullptr, 2, 8));
+}
+
+TEST_F(cfsm_test_async, cfsm_test_entry_action_may_start_another_asynchronous_transition) {
+    AsyncMachine machine(asyncAction);
+    cfsm_transition_set_async_action(&machine.t[1], suspendingAction);
+    machine.states[1].entry_action = startingEntryAction;
+    g_entering_fsm = &machine.fsm;
+
+    EXPECT_CALL(*g_async_action, call(_, _, _, 1, _)).WillOnce(Invoke(
+            [](struct cfsm_state *fsm, struct cfsm_state *, struct cfsm_state *, int, void *) {
+                cfsm_complete_transition(fsm);
+            }));
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event(&machine.fsm, 1, nullptr));
+    ASSERT_EQ(cfsm_status_pending, g_entry_status);
+    ASSERT_TRUE(cfsm_is_in_transition(&machine.fsm)) << "busy -> done is still in flight";
+    ASSERT_EQ(&machine.states[1], machine.fsm.current_state);
+
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_FALSE(cfsm_is_in_transition(&machine.fsm));
+    ASSERT_EQ(&machine.states[2], machine.fsm.current_state);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_entry_action_after_suspension_may_start_another_asynchronous_transition) {
+    AsyncMachine machine;
+    cfsm_transition_set_async_action(&machine.t[1], suspendingAction);
+    machine.states[1].entry_action = startingEntryAction;
+    g_entering_fsm = &machine.fsm;
+
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event(&machine.fsm, 1, nullptr));
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_EQ(cfsm_status_pending, g_entry_status);
+    ASSERT_TRUE(cfsm_is_in_transition(&machine.fsm));
+
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_EQ(&machine.states[2], machine.fsm.current_state);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_posted_event_is_not_dispatched_by_plain_transition) {
+    AsyncMachine machine;
+    cfsm_start(&machine.fsm, 0, nullptr);
+    machine.fsm.current_state = &machine.states[1];
+
+    cfsm_post_event(&machine.fsm, cfsm_event_alloc(nullptr, 1, 0));
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event(&machine.fsm, 2, nullptr));
+    ASSERT_EQ(1, cfsm_get_runtime(&machine.fsm)->inbox.size) << "inbox waits for cfsm_dispatch";
+    ASSERT_EQ(1, cfsm_dispatch(&machine.fsm));
+}
+
+TEST_F(cfsm_test_async, cfsm_test_deferred_event_is_replayed_after_completion) {
+    AsyncMachine machine;
+    machine.states[0].defer = asyncDeferAll;
+
+    cfsm_start(&machine.fsm, 0, nullptr);
+    ASSERT_EQ(cfsm_status_deffered, cfsm_process_event_sink(&machine.fsm, cfsm_event_alloc(nullptr, 2, 0)));
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event_sink(&machine.fsm, cfsm_event_alloc(nullptr, 1, 8)));
+
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_EQ(&machine.states[2], machine.fsm.current_state);
+    ASSERT_EQ(0, cfsm_get_runtime(&machine.fsm)->deferred.size);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_single_thread_multiplexes_machines_in_transition) {
+    const int count = 1000;
+    std::vector<std::unique_ptr<AsyncMachine>> machines;
+    for (int i = 0; i < count; ++i) {
+        machines.push_back(std::make_unique<AsyncMachine>());
+        ASSERT_EQ(cfsm_status_pending, cfsm_process_event(&machines.back()->fsm, 1, nullptr));
+        ASSERT_EQ(cfsm_status_queued, cfsm_process_event(&machines.back()->fsm, 2, nullptr));
+    }
+
+    for (int i = count - 1; i >= 0; --i) {
+        cfsm_complete_transition(&machines[i]->fsm);
+    }
+    for (auto &machine : machines) {
+        ASSERT_EQ(&machine->states[2], machine->fsm.current_state);
+    }
+}
+
+TEST_F(cfsm_test_async, cfsm_test_stop_and_completion_outside_transition_have_no_effect) {
+    AsyncMachine machine;
+
+    cfsm_complete_transition(&machine.fsm);
+    ASSERT_EQ(nullptr, machine.fsm.current_state);
+
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event(&machine.fsm, 1, nullptr));
+    cfsm_stop(&machine.fsm, 0, nullptr);
+    ASSERT_TRUE(cfsm_is_in_transition(&machine.fsm));
+    cfsm_complete_transition(&machine.fsm);
+}
+
+TEST_F(cfsm_test_async, cfsm_test_bulk_rejects_asynchronous_transitions) {
+    AsyncMachine machine;
+
+    cfsm_bulk bulk{};
+    ASSERT_FALSE(cfsm_bulk_init(&bulk, &machine.fsm));
+    cfsm_bulk_destroy(&bulk);
+}
@@ -0,0 +1,141 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_bulk.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+
+using namespace ::testing;
+
+struct BulkGuardMock {
+    MOCK_CONST_METHOD4(call, bool(struct cfsm_state *source, struct cfsm_state *target, int event_id, void *event_data));
+};
+
+std::unique_ptr<BulkGuardMock> g_bulk_guard;
+bool callBulkGuard(struct cfsm_state *source, struct cfsm_state *target, int event_id, void *event_data) {
+    return g_bulk_guard->call(source, target, event_id, event_data);
+}
+
+struct cfsm_test_bulk : Test {
+    enum { tick = 1, reload = 2, guarded = 3 };
+
+    cfsm_test_bulk() {
+        g_bulk_guard = std::make_unique<BulkGuardMock>();
+
+        cfsm_init_state(&states[0], "idle");
+        cfsm_init_state(&states[1], "busy");
+        cfsm_init_state(&states[2], "done");
+        cfsm_init(&c, 3, states, &states[0]);
+
+        // tick: idle -> busy -> done, reload: any -> idle, guarded: busy -> done when guard allows
+        cfsm_add_transition(&c, cfsm_init_transition(&t[0], &states[0], &states[1], tick));
+        cfsm_add_transition(&c, cfsm_init_transition(&t[1], &states[1], &states[2], tick));
+        cfsm_add_transition(&c, cfsm_init_transition(&t[2], &states[1], &states[0], reload));
+        cfsm_add_transition(&c, cfsm_init_transition(&t[3], &states[2], &states[0], reload));
+        cfsm_add_transition(&c, cfsm_init_transition_ag(&t[4], &states[1], &states[2], guarded, cfsm_null_action,
+                                                        callBulkGuard));
+
+        EXPECT_TRUE(cfsm_bulk_init(&bulk, &c));
+    }
+
+    ~cfsm_test_bulk() override {
+        cfsm_bulk_destroy(&bulk);
+        cfsm_state_destroy(&c);
+        g_bulk_guard.reset(nullptr);
+    }
+
+    cfsm_state states[3]{};
+    cfsm_transition t[5]{};
+    cfsm_state c{};
+    cfsm_bulk bulk{};
+};
+
+TEST_F(cfsm_test_bulk, cfsm_test_bulk_start_puts_instances_into_initial_state) {
+    std::vector<int> population(100, -1);
+    cfsm_bulk_start(&bulk, population.data(), (int)population.size(), 0, nullptr);
+
+    ASSERT_THAT(population, Each(0));
+}
+
+TEST_F(cfsm_test_bulk, cfsm_test_bulk_applies_event_by_table_lookup) {
+    std::vector<int> population = {0, 1, 2, -1, 1};
+    std::vector<cfsm_status> statuses(population.size());
+
+    ASSERT_EQ(3, cfsm_bulk_process_event(&bulk, tick, nullptr, population.data(), statuses.data(), (int)population.size()));
+
+    ASSERT_THAT(population, ElementsAre(1, 2, 2, -1, 2));
+    ASSERT_THAT(statuses, ElementsAre(cfsm_status_ok, cfsm_status_ok, cfsm_status_not_ok, cfsm_status_not_ok,
+                                      cfsm_status_ok));
+}
+
+TEST_F(cfsm_test_bulk, cfsm_test_bulk_unknown_event_leaves_population_untouched) {
+    std::vector<int> population = {0, 1, 2};
+    ASSERT_EQ(0, cfsm_bulk_process_event(&bulk, 999, nullptr, population.data(), nullptr, (int)population.size()));
+    ASSERT_THAT(population, ElementsAre(0, 1, 2));
+}
+
+TEST_F(cfsm_test_bulk, cfsm_test_bulk_calls_guard_only_for_instances_that_need_it) {
+    std::vector<int> population = {0, 1, 2, 1};
+    std::vector<cfsm_status> statuses(population.size());
+
+    EXPECT_CALL(*g_bulk_guard, call(&states[1], &states[2], guarded, nullptr))
+            .WillOnce(Return(true))
+            .WillOnce(Return(false));
+
+    ASSERT_EQ(1, cfsm_bulk_process_event(&bulk, guarded, nullptr, population.data(), statuses.data(),
+                                         (int)population.size()));
+    ASSERT_THAT(population, ElementsAre(0, 2, 2, 1));
+    ASSERT_THAT(statuses, ElementsAre(cfsm_status_not_ok, cfsm_status_ok, cfsm_status_not_ok,
+                                      cfsm_status_guard_rejected));
+}
+
+TEST_F(cfsm_test_bulk, cfsm_test_bulk_matches_single_instance_processing) {
+    const int events[] = {tick, tick, reload, tick, reload, reload, tick};
+
+    std::vector<int> population(3);
+    cfsm_bulk_start(&bulk, population.data(), (int)population.size(), 0, nullptr);
+
+    cfsm_start(&c, 0, nullptr);
+    for (int event_id : events) {
+        cfsm_process_event(&c, event_id, nullptr);
+        cfsm_bulk_process_event(&bulk, event_id, nullptr, population.data(), nullptr, (int)population.size());
+        ASSERT_THAT(population, Each(cfsm_bulk_state_index(&bulk, c.current_state)));
+    }
+    cfsm_stop(&c, 0, nullptr);
+}
+
+TEST_F(cfsm_test_bulk, cfsm_test_bulk_split_across_threads) {
+    const int count = 100002;
+    std::vector<int> population(count);
+    for (int i = 0; i < count; ++i) {
+        population[i] = i % 3;
+    }
+
+    ASSERT_EQ(count - count / 3, cfsm_bulk_process_event_mt(&bulk, reload, nullptr, population.data(), nullptr, count, 4));
+    ASSERT_THAT(population, Each(0));
+
+    ASSERT_EQ(count, cfsm_bulk_process_event_mt(&bulk, tick, nullptr, population.data(), nullptr, count, 4));
+    ASSERT_THAT(population, Each(1));
+}
+
+TEST(cfsm_test_bulk_init, cfsm_test_bulk_rejects_transition_leading_outside_definition) {
+    cfsm_state states[2]{};
+    cfsm_init_state(&states[0], "inside");
+    cfsm_init_state(&states[1], "outside");
+
+    cfsm_state c{};
+    cfsm_init(&c, 1, states, &states[0]);
+
+    cfsm_transition t{};
+    cfsm_add_transition(&c, cfsm_init_transition(&t, &states[0], &states[1], 1));
+
+    cfsm_bulk bulk{};
+    ASSERT_FALSE(cfsm_bulk_init(&bulk, &c));
+
+    cfsm_state_destroy(&c);
+    cfsm_state_destroy(&states[0]);
+}
@@ -0,0 +1,101 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_coro.hpp>
+
+#include <gtest/gtest.h>
+
+#include <coroutine>
+#include <deque>
+
+using namespace ::testing;
+
+/**
+ * stands for I/O completion: suspended coroutines wait until test resumes them
+ */
+std::deque<std::coroutine_handle<>> g_waiting;
+
+struct io_wait {
+    bool await_ready() noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        g_waiting.push_back(handle);
+    }
+
+    int await_resume() noexcept {
+        return 7;
+    }
+};
+
+int g_result = 0;
+
+cfsm::async_action load(cfsm::transition_context context) {
+    const int value = co_await io_wait{};
+    g_result = value + context.event_id;
+}
+
+cfsm::async_action immediate(cfsm::transition_context) {
+    co_return;
+}
+
+struct cfsm_test_coro : Test {
+    cfsm_test_coro() {
+        cfsm_init_state(&states[0], "idle");
+        cfsm_init_state(&states[1], "loaded");
+        cfsm_init_state(&states[2], "done");
+        cfsm_init(&fsm, 3, states, &states[0]);
+
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[0], &states[0], &states[1], 1));
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[1], &states[1], &states[2], 2));
+        g_waiting.clear();
+        g_result = 0;
+    }
+
+    ~cfsm_test_coro() override {
+        cfsm_stop(&fsm, 0, nullptr);
+        cfsm_state_destroy(&fsm);
+    }
+
+    cfsm_state states[3]{};
+    cfsm_state fsm{};
+    cfsm_transition t[2]{};
+};
+
+TEST_F(cfsm_test_coro, cfsm_test_coroutine_resumption_completes_transition) {
+    cfsm_transition_set_async_action(&t[0], cfsm::async<load>);
+
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event(&fsm, 1, nullptr));
+    ASSERT_EQ(cfsm_status_queued, cfsm_process_event(&fsm, 2, nullptr));
+    ASSERT_EQ(1u, g_waiting.size());
+    ASSERT_EQ(&states[0], fsm.current_state);
+
+    g_waiting.front().resume();
+    g_waiting.pop_front();
+
+    ASSERT_EQ(8, g_result);
+    ASSERT_FALSE(cfsm_is_in_transition(&fsm));
+    ASSERT_EQ(&states[2], fsm.current_state);
+}
+
+TEST_F(cfsm_test_coro, cfsm_test_coroutine_without_suspension_completes_immediately) {
+    cfsm_transition_set_async_action(&t[0], cfsm::async<immediate>);
+
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event(&fsm, 1, nullptr));
+    ASSERT_EQ(&states[1], fsm.current_state);
+}
+
+cfsm::async_action emitting(cfsm::transition_context context) {
+    cfsm_process_event(context.fsm, 2, nullptr);
+    co_return;
+}
+
+TEST_F(cfsm_test_coro, cfsm_test_event_emitted_by_coroutine_without_suspension_is_processed) {
+    cfsm_transition_set_async_action(&t[0], cfsm::async<emitting>);
+
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event(&fsm, 1, nullptr));
+    ASSERT_EQ(&states[2], fsm.current_state);
+    ASSERT_EQ(0, cfsm_get_runtime(&fsm)->inbox.size);
+}
@@ -0,0 +1,167 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <memory>
+
+using namespace ::testing;
+
+struct DeleterMock {
+    MOCK_CONST_METHOD1(call, void(void *event_data));
+};
+
+std::unique_ptr<DeleterMock> g_deleter;
+void callDeleter(void *event_data) {
+    g_deleter->call(event_data);
+}
+
+bool deferAll(struct cfsm_state *, int, void *) {
+    return true;
+}
+
+struct cfsm_test_events : Test {
+    cfsm_test_events() {
+        g_deleter = std::make_unique<DeleterMock>();
+        cfsm_event_pool_init(&pool, 4);
+
+        cfsm_init_state(&states[0], "state_0");
+        cfsm_init_state(&states[1], "state_1");
+        cfsm_init_state(&states[2], "state_2");
+        cfsm_init(&c, 3, states, &states[0]);
+    }
+
+    ~cfsm_test_events() override {
+        cfsm_stop(&c, 0, nullptr);
+        cfsm_state_destroy(&c);
+        cfsm_event_pool_destroy(&pool);
+        g_deleter.reset(nullptr);
+    }
+
+    cfsm_event_pool pool{};
+    cfsm_state states[3]{};
+    cfsm_state c{};
+    int payload = 42;
+};
+
+TEST_F(cfsm_test_events, cfsm_test_pool_reuses_released_envelopes) {
+    cfsm_event *e = cfsm_event_alloc(&pool, 1, sizeof(int));
+    ASSERT_NE(nullptr, e);
+    ASSERT_NE(nullptr, e->event_data) << "inline payload storage is provided";
+    ASSERT_EQ(sizeof(int), e->size);
+
+    cfsm_event_release(e);
+
+    ASSERT_EQ(e, cfsm_event_alloc(&pool, 2, 8)) << "same size class block is recycled";
+    cfsm_event_release(e);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_pool_keeps_size_classes_apart) {
+    cfsm_event *small = cfsm_event_alloc(&pool, 1, 0);
+    cfsm_event *large = cfsm_event_alloc(&pool, 1, 200);
+
+    ASSERT_EQ(nullptr, small->event_data);
+    ASSERT_NE(small->size_class, large->size_class);
+    std::memset(large->event_data, 0xab, 200);
+
+    cfsm_event_release(small);
+    cfsm_event_release(large);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_oversized_payload_falls_back_to_heap) {
+    cfsm_event *e = cfsm_event_alloc(&pool, 1, 4 * CFSM_EVENT_POOL_MAX_PAYLOAD);
+    ASSERT_NE(nullptr, e);
+    std::memset(e->event_data, 0, 4 * CFSM_EVENT_POOL_MAX_PAYLOAD);
+    cfsm_event_release(e);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_envelope_works_as_unique_ptr_deleter) {
+    EXPECT_CALL(*g_deleter, call(&payload)).Times(1);
+
+    std::unique_ptr<cfsm_event, decltype(&cfsm_event_release)> e{
+            cfsm_event_wrap(nullptr, 1, &payload, sizeof(payload), callDeleter), cfsm_event_release};
+}
+
+TEST_F(cfsm_test_events, cfsm_test_sink_releases_consumed_event) {
+    cfsm_transition t{};
+    cfsm_init_transition(&t, &states[0], &states[1], 1);
+    cfsm_add_transition(&c, &t);
+
+    EXPECT_CALL(*g_deleter, call(&payload)).Times(1);
+
+    cfsm_event *e = cfsm_event_wrap(&pool, 1, &payload, sizeof(payload), callDeleter);
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event_sink(&c, e));
+    ASSERT_EQ(&states[1], c.current_state);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_sink_releases_unhandled_event_when_not_deferred) {
+    EXPECT_CALL(*g_deleter, call(&payload)).Times(1);
+
+    cfsm_event *e = cfsm_event_wrap(&pool, 1, &payload, sizeof(payload), callDeleter);
+    ASSERT_EQ(cfsm_status_not_ok, cfsm_process_event_sink(&c, e));
+    ASSERT_EQ(0, cfsm_get_runtime(&c)->deferred.size);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_deferred_event_is_processed_after_state_change) {
+    states[0].defer = deferAll;
+
+    cfsm_transition t01{};
+    cfsm_init_transition(&t01, &states[0], &states[1], 1);
+    cfsm_add_transition(&c, &t01);
+
+    cfsm_transition t12{};
+    cfsm_init_transition(&t12, &states[1], &states[2], 2);
+    cfsm_add_transition(&c, &t12);
+
+    EXPECT_CALL(*g_deleter, call(&payload)).Times(0);
+
+    cfsm_event *e = cfsm_event_wrap(&pool, 2, &payload, sizeof(payload), callDeleter);
+    ASSERT_EQ(cfsm_status_deffered, cfsm_process_event_sink(&c, e));
+    ASSERT_EQ(1, cfsm_get_runtime(&c)->deferred.size);
+    ASSERT_EQ(&states[0], c.current_state);
+
+    Mock::VerifyAndClearExpectations(g_deleter.get());
+    EXPECT_CALL(*g_deleter, call(&payload)).Times(1);
+
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event_sink(&c, cfsm_event_alloc(&pool, 1, 0)));
+    ASSERT_EQ(&states[2], c.current_state) << "deferred event is taken right after entering new state";
+    ASSERT_EQ(0, cfsm_get_runtime(&c)->deferred.size);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_deferred_event_without_transition_stays_queued) {
+    states[0].defer = deferAll;
+
+    cfsm_transition t01{};
+    cfsm_init_transition(&t01, &states[0], &states[1], 1);
+    cfsm_add_transition(&c, &t01);
+
+    ASSERT_EQ(cfsm_status_deffered, cfsm_process_event_sink(&c, cfsm_event_alloc(&pool, 7, 0)));
+    ASSERT_EQ(cfsm_status_ok, cfsm_process_event(&c, 1, nullptr));
+
+    ASSERT_EQ(1, cfsm_get_runtime(&c)->deferred.size) << "transition not found leaves event on deferred queue";
+    ASSERT_EQ(7, cfsm_get_runtime(&c)->deferred.head->event_id);
+}
+
+TEST_F(cfsm_test_events, cfsm_test_dispatch_drains_inbox_in_order) {
+    cfsm_transition t01{};
+    cfsm_init_transition(&t01, &states[0], &states[1], 1);
+    cfsm_add_transition(&c, &t01);
+
+    cfsm_transition t12{};
+    cfsm_init_transition(&t12, &states[1], &states[2], 2);
+    cfsm_add_transition(&c, &t12);
+
+    cfsm_post_event(&c, cfsm_event_alloc(&pool, 1, 0));
+    cfsm_post_event(&c, cfsm_event_alloc(&pool, 2, 0));
+    ASSERT_EQ(2, cfsm_get_runtime(&c)->inbox.size);
+    ASSERT_EQ(nullptr, c.current_state) << "posting does not process";
+
+    ASSERT_EQ(2, cfsm_dispatch(&c));
+    ASSERT_EQ(&states[2], c.current_state);
+    ASSERT_EQ(0, cfsm_get_runtime(&c)->inbox.size);
+}
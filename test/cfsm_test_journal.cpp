@@ -0,0 +1,243 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_journal.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace ::testing;
+
+size_t serializeInt(int, const void *event_data, void *buffer, size_t capacity) {
+    if (nullptr == event_data) {
+        return 0;
+    }
+    if (capacity >= sizeof(int)) {
+        std::memcpy(buffer, event_data, sizeof(int));
+    }
+    return sizeof(int);
+}
+
+void *deserializeInt(int, const void *bytes, size_t size, void *context) {
+    if (sizeof(int) != size) {
+        return nullptr;
+    }
+    std::memcpy(context, bytes, sizeof(int));
+    return context;
+}
+
+bool evenPayloadGuard(struct cfsm_state *, struct cfsm_state *, int, void *event_data) {
+    return nullptr != event_data && 0 == *static_cast<int *>(event_data) % 2;
+}
+
+bool oddPayloadGuard(struct cfsm_state *, struct cfsm_state *, int, void *event_data) {
+    return nullptr != event_data && 1 == *static_cast<int *>(event_data) % 2;
+}
+
+/**
+ * ping <-> pong on event 1, pong -> ping on event 2 only for even payload
+ */
+struct JournalMachine {
+    explicit JournalMachine(cfsm_guard_f guard = evenPayloadGuard) {
+        cfsm_init_state(&states[0], "ping");
+        cfsm_init_state(&states[1], "pong");
+        cfsm_init(&fsm, 2, states, &states[0]);
+
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[0], &states[0], &states[1], 1));
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[1], &states[1], &states[0], 1));
+        cfsm_add_transition(&fsm, cfsm_init_transition_ag(&t[2], &states[1], &states[0], 2, cfsm_null_action, guard));
+    }
+
+    ~JournalMachine() {
+        cfsm_stop(&fsm, 0, nullptr);
+        cfsm_state_destroy(&fsm);
+    }
+
+    cfsm_state states[2]{};
+    cfsm_state fsm{};
+    cfsm_transition t[3]{};
+};
+
+struct cfsm_test_journal : Test {
+    cfsm_test_journal() {
+        stream = tmpfile();
+    }
+
+    ~cfsm_test_journal() override {
+        fclose(stream);
+    }
+
+    void record(int count) {
+        JournalMachine machine;
+
+        cfsm_journal journal{};
+        ASSERT_TRUE(cfsm_journal_open(&journal, stream, serializeInt));
+
+        cfsm_journal_writer writer{};
+        ASSERT_TRUE(cfsm_journal_writer_init(&writer, &journal));
+        for (int i = 0; i < count; ++i) {
+            int payload = i / 3;
+            cfsm_journal_process_event(&writer, &machine.fsm, 1 + i % 2, &payload);
+        }
+        cfsm_journal_writer_flush(&writer);
+
+        ASSERT_TRUE(cfsm_journal_close(&journal));
+        rewind(stream);
+    }
+
+    FILE *stream = nullptr;
+};
+
+TEST_F(cfsm_test_journal, cfsm_test_replay_reproduces_recorded_outcomes) {
+    const int count = 100000; // spans many journal buffers
+    record(count);
+
+    JournalMachine machine;
+    int scratch = 0;
+    cfsm_replay_report report{};
+    ASSERT_TRUE(cfsm_journal_replay(stream, -1, &machine.fsm, deserializeInt, &scratch, &report));
+
+    ASSERT_EQ(count, report.events);
+    ASSERT_EQ(0, report.mismatches);
+    ASSERT_EQ(-1, report.first_mismatch);
+}
+
+TEST_F(cfsm_test_journal, cfsm_test_replay_detects_diverging_machine) {
+    record(10);
+
+    JournalMachine machine(oddPayloadGuard);
+    int scratch = 0;
+    cfsm_replay_report report{};
+    ASSERT_TRUE(cfsm_journal_replay(stream, -1, &machine.fsm, deserializeInt, &scratch, &report));
+
+    ASSERT_EQ(10, report.events);
+    ASSERT_LT(0, report.mismatches);
+    ASSERT_EQ(1, report.first_mismatch) << "second event (payload 0) is accepted only by even guard";
+}
+
+TEST_F(cfsm_test_journal, cfsm_test_replay_rejects_truncated_journal) {
+    record(10);
+
+    std::fseek(stream, 0, SEEK_END);
+    const long size = std::ftell(stream);
+    std::vector<char> bytes(size - 3);
+    rewind(stream);
+    ASSERT_EQ(bytes.size(), std::fread(bytes.data(), 1, bytes.size(), stream));
+
+    FILE *truncated = tmpfile();
+    std::fwrite(bytes.data(), 1, bytes.size(), truncated);
+    rewind(truncated);
+
+    JournalMachine machine;
+    cfsm_replay_report report{};
+    ASSERT_FALSE(cfsm_journal_replay(truncated, -1, &machine.fsm, nullptr, nullptr, &report));
+    ASSERT_EQ(9, report.events);
+
+    fclose(truncated);
+}
+
+cfsm_journal_writer *g_nested_writer = nullptr;
+cfsm_state *g_nested_fsm = nullptr;
+std::vector<int> g_replayed_payloads;
+
+void *deserializeAndRecordInt(int event_id, const void *bytes, size_t size, void *context) {
+    void *event_data = deserializeInt(event_id, bytes, size, context);
+    g_replayed_payloads.push_back(nullptr != event_data ? *static_cast<int *>(event_data) : -1);
+    return event_data;
+}
+
+/**
+ * ping -> pong action emits event 3 with payload 999, journaled while ping -> pong is in progress
+ */
+void emittingAction(struct cfsm_state *, struct cfsm_state *, int, void *) {
+    int payload = 999;
+    if (nullptr != g_nested_writer) {
+        cfsm_journal_process_event(g_nested_writer, g_nested_fsm, 3, &payload);
+    } else {
+        cfsm_process_event(g_nested_fsm, 3, &payload);
+    }
+}
+
+TEST_F(cfsm_test_journal, cfsm_test_events_journaled_by_actions_are_nested_behind_their_cause) {
+    const int count = 20000; // spans several journal buffers
+    {
+        JournalMachine machine;
+        cfsm_transition_set_action(&machine.t[0], emittingAction);
+        g_nested_fsm = &machine.fsm;
+
+        cfsm_journal journal{};
+        ASSERT_TRUE(cfsm_journal_open(&journal, stream, serializeInt));
+        cfsm_journal_writer writer{};
+        ASSERT_TRUE(cfsm_journal_writer_init(&writer, &journal));
+        g_nested_writer = &writer;
+        for (int i = 0; i < count; ++i) {
+            int payload = 42;
+            cfsm_journal_process_event(&writer, &machine.fsm, 1, &payload);
+        }
+        g_nested_writer = nullptr;
+        cfsm_journal_writer_flush(&writer);
+        ASSERT_TRUE(cfsm_journal_close(&journal));
+        rewind(stream);
+    }
+
+    JournalMachine machine;
+    cfsm_transition_set_action(&machine.t[0], emittingAction);
+    g_nested_fsm = &machine.fsm;
+    int scratch = 0;
+    cfsm_replay_report report{};
+    g_replayed_payloads.clear();
+    ASSERT_TRUE(cfsm_journal_replay(stream, -1, &machine.fsm, deserializeAndRecordInt, &scratch, &report));
+
+    ASSERT_EQ(count + count / 2, report.events);
+    ASSERT_EQ(0, report.mismatches);
+    ASSERT_EQ(std::vector<int>(count, 42), g_replayed_payloads)
+            << "outer payload survives nesting, nested records are left to emitting action";
+}
+
+TEST_F(cfsm_test_journal, cfsm_test_replay_selects_records_of_single_writer) {
+    const int count = 10;
+    {
+        JournalMachine first;
+        JournalMachine second;
+
+        cfsm_journal journal{};
+        ASSERT_TRUE(cfsm_journal_open(&journal, stream, serializeInt));
+        cfsm_journal_writer writers[2]{};
+        ASSERT_TRUE(cfsm_journal_writer_init(&writers[0], &journal));
+        ASSERT_TRUE(cfsm_journal_writer_init(&writers[1], &journal));
+        ASSERT_EQ(1, writers[1].id);
+
+        for (int i = 0; i < count; ++i) {
+            int payload = i / 3;
+            cfsm_journal_process_event(&writers[0], &first.fsm, 1 + i % 2, &payload);
+            payload = 1;
+            cfsm_journal_process_event(&writers[1], &second.fsm, 1, &payload);
+            if (0 == i % 4) {
+                // interleave buffers of both writers
+                cfsm_journal_writer_flush(&writers[i % 8 / 4]);
+            }
+        }
+        cfsm_journal_writer_flush(&writers[0]);
+        cfsm_journal_writer_flush(&writers[1]);
+        ASSERT_TRUE(cfsm_journal_close(&journal));
+    }
+
+    for (int writer_id = 0; writer_id < 2; ++writer_id) {
+        rewind(stream);
+        JournalMachine machine;
+        int scratch = 0;
+        cfsm_replay_report report{};
+        ASSERT_TRUE(cfsm_journal_replay(stream, writer_id, &machine.fsm, deserializeInt, &scratch, &report));
+        ASSERT_EQ(count, report.events);
+        ASSERT_EQ(0, report.mismatches);
+    }
+
+    rewind(stream);
+    JournalMachine machine;
+    cfsm_replay_report report{};
+    ASSERT_FALSE(cfsm_journal_replay(stream, -1, &machine.fsm, nullptr, nullptr, &report))
+            << "journal of many writers is ambiguous without writer id";
+}
@@ -0,0 +1,138 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_minimize.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace ::testing;
+
+void minimize_entry_action(struct cfsm_state *, int, void *) {}
+
+bool minimize_guard(struct cfsm_state *, struct cfsm_state *, int, void *) {
+    return true;
+}
+
+struct cfsm_test_minimize : Test {
+    explicit cfsm_test_minimize(int n = 6) : states(n), transitions(4 * n) {
+        for (int i = 0; i < n; ++i) {
+            cfsm_init_state(&states[i], "state");
+        }
+        cfsm_init(&c, n, states.data(), &states[0]);
+    }
+
+    ~cfsm_test_minimize() override {
+        cfsm_minimized_destroy(&minimized);
+        cfsm_state_destroy(&c);
+    }
+
+    void add(int source, int target, int event_id, cfsm_guard_f guard = cfsm_null_guard) {
+        cfsm_transition *t = &transitions[num_transitions++];
+        cfsm_init_transition_ag(t, &states[source], &states[target], event_id, cfsm_null_action, guard);
+        cfsm_add_transition(&c, t);
+    }
+
+    int mapped(int original) {
+        return (int)(cfsm_minimized_state(&minimized, &states[original]) - minimized.states);
+    }
+
+    std::vector<cfsm_state> states;
+    std::vector<cfsm_transition> transitions;
+    int num_transitions = 0;
+    cfsm_state c{};
+    cfsm_minimized minimized{};
+};
+
+TEST_F(cfsm_test_minimize, cfsm_test_minimize_merges_equivalent_states) {
+    // 0 -a-> 1 -a-> 3, 0 -b-> 2 -a-> 3: states 1 and 2 are indistinguishable, so are 3, 4 and 5
+    add(0, 1, 'a');
+    add(0, 2, 'b');
+    add(1, 3, 'a');
+    add(2, 3, 'a');
+
+    ASSERT_TRUE(cfsm_minimize(&c, &minimized));
+
+    ASSERT_EQ(mapped(1), mapped(2));
+    ASSERT_NE(mapped(0), mapped(1));
+    ASSERT_NE(mapped(1), mapped(3)) << "3 does not accept 'a'";
+    ASSERT_EQ(mapped(3), mapped(5));
+    ASSERT_EQ(3, minimized.num_states);
+    ASSERT_EQ(&minimized.states[mapped(0)], minimized.fsm.initial_state);
+}
+
+TEST_F(cfsm_test_minimize, cfsm_test_minimize_keeps_states_with_different_actions_apart) {
+    add(0, 1, 'a');
+    add(0, 2, 'b');
+    add(1, 3, 'a');
+    add(2, 3, 'a', minimize_guard);
+    states[4].entry_action = minimize_entry_action;
+
+    ASSERT_TRUE(cfsm_minimize(&c, &minimized));
+
+    ASSERT_NE(mapped(1), mapped(2)) << "guards differ";
+    ASSERT_NE(mapped(4), mapped(5)) << "entry actions differ";
+    ASSERT_EQ(mapped(3), mapped(5));
+    ASSERT_EQ(5, minimized.num_states);
+}
+
+TEST_F(cfsm_test_minimize, cfsm_test_minimized_machine_behaves_like_original) {
+    add(0, 1, 'a');
+    add(0, 2, 'b');
+    add(1, 3, 'a');
+    add(2, 3, 'a');
+    add(3, 0, 'r');
+
+    ASSERT_TRUE(cfsm_minimize(&c, &minimized));
+
+    const int events[] = {'b', 'a', 'r', 'a', 'x', 'a', 'r'};
+    cfsm_start(&c, 0, nullptr);
+    cfsm_start(&minimized.fsm, 0, nullptr);
+    for (int event_id : events) {
+        ASSERT_EQ(cfsm_process_event(&c, event_id, nullptr), cfsm_process_event(&minimized.fsm, event_id, nullptr));
+        ASSERT_EQ(cfsm_minimized_state(&minimized, c.current_state), minimized.fsm.current_state);
+    }
+    cfsm_stop(&c, 0, nullptr);
+    cfsm_stop(&minimized.fsm, 0, nullptr);
+}
+
+TEST_F(cfsm_test_minimize, cfsm_test_minimize_rejects_nondeterministic_definition) {
+    add(0, 1, 'a', minimize_guard);
+    add(0, 2, 'a');
+
+    ASSERT_FALSE(cfsm_minimize(&c, &minimized));
+}
+
+struct cfsm_test_minimize_large : cfsm_test_minimize {
+    enum { size = 100000 };
+
+    cfsm_test_minimize_large() : cfsm_test_minimize(size) {}
+};
+
+TEST_F(cfsm_test_minimize_large, cfsm_test_minimize_large_ring) {
+    // ring of states where every third one announces itself on entry collapses into ring of three
+    for (int i = 0; i < size; ++i) {
+        if (0 == i % 3) {
+            states[i].entry_action = minimize_entry_action;
+        }
+        add(i, (i + 1) % size, 'n');
+        add(i, 0, 'r');
+    }
+    // 100000 is not divisible by three, so last state breaks periodicity of the ring
+    ASSERT_TRUE(cfsm_minimize(&c, &minimized));
+    ASSERT_EQ(size, minimized.num_original_states);
+    ASSERT_EQ(size, minimized.num_states);
+}
+
+TEST_F(cfsm_test_minimize_large, cfsm_test_minimize_large_chain_of_equivalent_states) {
+    for (int i = 0; i < size; ++i) {
+        add(i, (i + 1) % size, 'n');
+        add(i, i, 's');
+    }
+
+    ASSERT_TRUE(cfsm_minimize(&c, &minimized));
+    ASSERT_EQ(1, minimized.num_states);
+    ASSERT_EQ(2, minimized.num_transitions);
+}
@@ -0,0 +1,198 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_priority.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace ::testing;
+
+enum {
+    shutdown_event = 1,
+    status_event = 2,
+    ping_event = 3,
+    config_event = 4,
+    data_event = 5
+};
+
+struct cfsm_test_priority : Test {
+    cfsm_test_priority() {
+        cfsm_event_pool_init(&pool, 0);
+    }
+
+    ~cfsm_test_priority() override {
+        cfsm_priority_queue_clear(&queue);
+        cfsm_event_pool_destroy(&pool);
+    }
+
+    void init(int capacity) {
+        storage.resize(3 * capacity);
+        ASSERT_TRUE(cfsm_priority_queue_init(&queue, rules, 4, queued, 3, storage.data(), capacity));
+    }
+
+    cfsm_event *event(int event_id, int value) {
+        cfsm_event *e = cfsm_event_alloc(&pool, event_id, sizeof(int));
+        *static_cast<int *>(e->event_data) = value;
+        return e;
+    }
+
+    std::vector<std::pair<int, int>> drain() {
+        std::vector<std::pair<int, int>> result;
+        while (cfsm_event *e = cfsm_priority_queue_pop(&queue)) {
+            result.emplace_back(e->event_id, *static_cast<int *>(e->event_data));
+            cfsm_event_release(e);
+        }
+        return result;
+    }
+
+    static const cfsm_priority_rule rules[4];
+    int queued[4]{};
+    std::vector<cfsm_event *> storage;
+    cfsm_event_pool pool{};
+    cfsm_priority_queue queue{};
+};
+
+const cfsm_priority_rule cfsm_test_priority::rules[4] = {
+        {shutdown_event, 0, cfsm_coalesce_none},
+        {status_event, 1, cfsm_coalesce_keep_latest},
+        {ping_event, 1, cfsm_coalesce_drop_duplicates},
+        {config_event, 2, cfsm_coalesce_keep_latest},
+};
+
+TEST_F(cfsm_test_priority, cfsm_test_urgent_class_goes_first_and_fifo_within_class) {
+    init(8);
+
+    cfsm_priority_queue_push(&queue, event(data_event, 1));
+    cfsm_priority_queue_push(&queue, event(status_event, 2));
+    cfsm_priority_queue_push(&queue, event(data_event, 3));
+    cfsm_priority_queue_push(&queue, event(shutdown_event, 4));
+
+    const std::vector<std::pair<int, int>> expected = {
+            {shutdown_event, 4}, {status_event, 2}, {data_event, 1}, {data_event, 3}};
+    ASSERT_EQ(expected, drain());
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_keep_latest_replaces_queued_event_in_place) {
+    init(8);
+
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(status_event, 1)));
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(ping_event, 2)));
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(status_event, 3)));
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(status_event, 4)));
+
+    ASSERT_EQ(2, cfsm_priority_queue_size(&queue));
+    ASSERT_EQ(2, queue.coalesced);
+
+    const std::vector<std::pair<int, int>> expected = {{status_event, 4}, {ping_event, 2}};
+    ASSERT_EQ(expected, drain());
+
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(status_event, 5)));
+    ASSERT_EQ(1, cfsm_priority_queue_size(&queue)) << "popped event is no longer coalesced with";
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_drop_duplicates_keeps_oldest_event) {
+    init(8);
+
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(ping_event, 1)));
+    ASSERT_FALSE(cfsm_priority_queue_push(&queue, event(ping_event, 2)));
+    ASSERT_EQ(1, queue.coalesced);
+
+    const std::vector<std::pair<int, int>> expected = {{ping_event, 1}};
+    ASSERT_EQ(expected, drain());
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_full_class_drops_without_affecting_others) {
+    init(2);
+
+    for (int i = 0; i < 5; ++i) {
+        cfsm_priority_queue_push(&queue, event(data_event, i));
+    }
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(shutdown_event, 9)));
+    ASSERT_EQ(3, queue.dropped);
+
+    const std::vector<std::pair<int, int>> expected = {{shutdown_event, 9}, {data_event, 0}, {data_event, 1}};
+    ASSERT_EQ(expected, drain());
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_ring_wraps_around_with_coalescing) {
+    init(3);
+
+    for (int round = 0; round < 10; ++round) {
+        cfsm_priority_queue_push(&queue, event(config_event, round));
+        cfsm_priority_queue_push(&queue, event(data_event, round));
+        cfsm_priority_queue_push(&queue, event(config_event, round + 100));
+
+        const std::vector<std::pair<int, int>> expected = {{config_event, round + 100}, {data_event, round}};
+        ASSERT_EQ(expected, drain());
+    }
+    ASSERT_EQ(10, queue.coalesced);
+    ASSERT_EQ(0, queue.dropped);
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_init_rejects_malformed_rules) {
+    cfsm_event *slots[4];
+    int bookkeeping[2];
+    const cfsm_priority_rule unknown_class[] = {{shutdown_event, 2, cfsm_coalesce_none}};
+    ASSERT_FALSE(cfsm_priority_queue_init(&queue, unknown_class, 1, bookkeeping, 2, slots, 2));
+
+    const cfsm_priority_rule duplicate[] = {{status_event, 0, cfsm_coalesce_none},
+                                            {status_event, 1, cfsm_coalesce_keep_latest}};
+    ASSERT_FALSE(cfsm_priority_queue_init(&queue, duplicate, 2, bookkeeping, 2, slots, 2));
+
+    const cfsm_priority_rule unsorted[] = {{status_event, 0, cfsm_coalesce_none},
+                                           {shutdown_event, 1, cfsm_coalesce_none}};
+    ASSERT_FALSE(cfsm_priority_queue_init(&queue, unsorted, 2, bookkeeping, 2, slots, 2));
+
+    ASSERT_FALSE(cfsm_priority_queue_init(&queue, nullptr, 0, nullptr, CFSM_PRIORITY_MAX_CLASSES + 1, slots, 2));
+    ASSERT_TRUE(cfsm_priority_queue_init(&queue, nullptr, 0, nullptr, 2, slots, 2));
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_queues_sharing_rules_coalesce_independently) {
+    init(4);
+
+    std::vector<cfsm_event *> other_storage(3 * 4);
+    int other_queued[4];
+    cfsm_priority_queue other{};
+    ASSERT_TRUE(cfsm_priority_queue_init(&other, rules, 4, other_queued, 3, other_storage.data(), 4));
+
+    ASSERT_TRUE(cfsm_priority_queue_push(&queue, event(status_event, 1)));
+    ASSERT_TRUE(cfsm_priority_queue_push(&other, event(status_event, 2)));
+    ASSERT_EQ(1, cfsm_priority_queue_size(&other));
+    ASSERT_EQ(0, other.coalesced);
+
+    cfsm_event *e = cfsm_priority_queue_pop(&other);
+    ASSERT_EQ(2, *static_cast<int *>(e->event_data));
+    cfsm_event_release(e);
+
+    const std::vector<std::pair<int, int>> expected = {{status_event, 1}};
+    ASSERT_EQ(expected, drain());
+    cfsm_priority_queue_clear(&other);
+}
+
+TEST_F(cfsm_test_priority, cfsm_test_dispatch_feeds_machine_in_priority_order) {
+    init(8);
+
+    cfsm_state states[2]{};
+    cfsm_init_state(&states[0], "running");
+    cfsm_init_state(&states[1], "halted");
+    cfsm_state c{};
+    cfsm_init(&c, 2, states, &states[0]);
+    cfsm_transition t{};
+    cfsm_add_transition(&c, cfsm_init_transition(&t, &states[0], &states[1], shutdown_event));
+
+    for (int i = 0; i < 5; ++i) {
+        cfsm_priority_queue_push(&queue, event(status_event, i));
+    }
+    cfsm_priority_queue_push(&queue, event(shutdown_event, 0));
+
+    ASSERT_EQ(1, cfsm_priority_queue_dispatch(&queue, &c, 1));
+    ASSERT_EQ(&states[1], c.current_state) << "shutdown overtakes flood of status events";
+    ASSERT_EQ(1, cfsm_priority_queue_dispatch(&queue, &c, -1));
+    ASSERT_EQ(0, cfsm_priority_queue_size(&queue));
+
+    cfsm_stop(&c, 0, nullptr);
+    cfsm_state_destroy(&c);
+}
@@ -0,0 +1,291 @@
+/**
+ * Licensed under the MIT License. See LICENSE file in the project root for full license information.
+ */
+
+#include <cfsm/cfsm_snapshot.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+using namespace ::testing;
+
+struct SnapshotEntryActionMock {
+    MOCK_CONST_METHOD3(call, void(struct cfsm_state *state, int event_id, void *event_data));
+};
+
+std::unique_ptr<SnapshotEntryActionMock> g_snapshot_entry;
+void snapshotEntryAction(struct cfsm_state *state, int event_id, void *event_data) {
+    g_snapshot_entry->call(state, event_id, event_data);
+}
+
+bool snapshotDeferAll(struct cfsm_state *, int, void *) {
+    return true;
+}
+
+/**
+ * fsm: a <-> b, where b contains sub-machine b1 <-> b2
+ */
+struct SnapshotMachine {
+    SnapshotMachine() {
+        cfsm_init_state(&sub[0], "b1");
+        cfsm_init_state(&sub[1], "b2");
+        cfsm_init_state(&top[0], "a");
+        cfsm_init_state(&top[1], "b");
+        cfsm_init(&top[1], 2, sub, &sub[0]);
+        cfsm_init_state(&fsm, "fsm");
+        cfsm_init(&fsm, 2, top, &top[0]);
+
+        top[1].entry_action = snapshotEntryAction;
+        top[0].defer = snapshotDeferAll;
+
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[0], &top[0], &top[1], 1));
+        cfsm_add_transition(&fsm, cfsm_init_transition(&t[1], &top[1], &top[0], 2));
+        cfsm_add_transition(&top[1], cfsm_init_transition(&t[2], &sub[0], &sub[1], 3));
+    }
+
+    ~SnapshotMachine() {
+        fsm.current_state = nullptr;
+        top[1].current_state = nullptr;
+        cfsm_state_destroy(&fsm);
+    }
+
+    cfsm_state sub[2]{};
+    cfsm_state top[2]{};
+    cfsm_state fsm{};
+    cfsm_transition t[3]{};
+};
+
+struct cfsm_test_snapshot : Test {
+    cfsm_test_snapshot() {
+        g_snapshot_entry = std::make_unique<NiceMock<SnapshotEntryActionMock>>();
+        cfsm_event_pool_init(&pool, 0);
+        stream = tmpfile();
+    }
+
+    ~cfsm_test_snapshot() override {
+        fclose(stream);
+        cfsm_event_pool_destroy(&pool);
+        g_snapshot_entry.reset(nullptr);
+    }
+
+    cfsm_event_pool pool{};
+    FILE *stream = nullptr;
+};
+
+TEST_F(cfsm_test_snapshot, cfsm_test_restore_rebuilds_nested_states_without_entry_actions) {
+    SnapshotMachine original;
+    cfsm_process_event(&original.fsm, 1, nullptr);
+    cfsm_process_event(&original.top[1], 3, nullptr);
+
+    struct cfsm_state *fsms[] = {&original.fsm};
+    ASSERT_TRUE(cfsm_snapshot(stream, fsms, 1));
+
+    SnapshotMachine restored;
+    struct cfsm_state *restored_fsms[] = {&restored.fsm};
+
+    EXPECT_CALL(*g_snapshot_entry, call(_, _, _)).Times(0);
+
+    rewind(stream);
+    ASSERT_TRUE(cfsm_restore(stream, restored_fsms, 1, &pool));
+
+    ASSERT_EQ(&restored.top[1], restored.fsm.current_state);
+    ASSERT_EQ(&restored.sub[1], restored.top[1].current_state);
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_restore_keeps_history_and_deferred_events) {
+    SnapshotMachine original;
+    cfsm_process_event(&original.fsm, 1, nullptr);
+    cfsm_process_event(&original.top[1], 3, nullptr);
+    cfsm_process_event(&original.fsm, 2, nullptr);
+
+    const char payload[] = "payload";
+    cfsm_event *e = cfsm_event_alloc(&pool, -17, sizeof(payload));
+    std::memcpy(e->event_data, payload, sizeof(payload));
+    ASSERT_EQ(cfsm_status_deffered, cfsm_process_event_sink(&original.fsm, e));
+
+    struct cfsm_state *fsms[] = {&original.fsm};
+    ASSERT_TRUE(cfsm_snapshot(stream, fsms, 1));
+
+    SnapshotMachine restored;
+    struct cfsm_state *restored_fsms[] = {&restored.fsm};
+
+    rewind(stream);
+    ASSERT_TRUE(cfsm_restore(stream, restored_fsms, 1, &pool));
+
+    ASSERT_EQ(&restored.top[0], restored.fsm.current_state);
+    ASSERT_EQ(&restored.sub[1], restored.top[1].current_state) << "inactive sub-machine remembers its state";
+    ASSERT_EQ(1, cfsm_get_runtime(&restored.fsm)->deferred.size);
+    ASSERT_EQ(-17, cfsm_get_runtime(&restored.fsm)->deferred.head->event_id);
+    ASSERT_STREQ(payload, static_cast<const char *>(cfsm_get_runtime(&restored.fsm)->deferred.head->event_data));
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_restore_rejects_mismatching_snapshot) {
+    SnapshotMachine original;
+    struct cfsm_state *fsms[] = {&original.fsm, &original.fsm};
+    ASSERT_TRUE(cfsm_snapshot(stream, fsms, 2));
+
+    rewind(stream);
+    ASSERT_FALSE(cfsm_restore(stream, fsms, 1, &pool)) << "instance count differs";
+
+    cfsm_state flat{};
+    cfsm_init(&flat, 0, nullptr, nullptr);
+    struct cfsm_state *flat_fsms[] = {&flat};
+
+    rewind(stream);
+    std::fputs("garbage", stream);
+    rewind(stream);
+    ASSERT_FALSE(cfsm_restore(stream, flat_fsms, 1, &pool));
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_bulk_population_round_trip) {
+    cfsm_state states[200]{};
+    for (auto &state : states) {
+        cfsm_init_state(&state, "state");
+    }
+    cfsm_state c{};
+    cfsm_init(&c, 200, states, &states[0]);
+
+    cfsm_bulk bulk{};
+    ASSERT_TRUE(cfsm_bulk_init(&bulk, &c));
+
+    const int count = 1000000;
+    std::vector<int> population(count);
+    for (int i = 0; i < count; ++i) {
+        population[i] = i % 201 - 1;
+    }
+    ASSERT_TRUE(cfsm_bulk_snapshot(stream, &bulk, population.data(), count));
+
+    std::vector<int> restored(count, 7);
+    rewind(stream);
+    ASSERT_TRUE(cfsm_bulk_restore(stream, &bulk, restored.data(), count));
+    ASSERT_EQ(population, restored);
+
+    cfsm_bulk_destroy(&bulk);
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_failed_restore_leaves_instances_untouched) {
+    SnapshotMachine first;
+    SnapshotMachine second;
+    cfsm_process_event(&first.fsm, 1, nullptr);
+    cfsm_process_event(&second.fsm, 1, nullptr);
+    cfsm_process_event(&second.top[1], 3, nullptr);
+    struct cfsm_state *fsms[] = {&first.fsm, &second.fsm};
+    ASSERT_TRUE(cfsm_snapshot(stream, fsms, 2));
+
+    // second instance of different, smaller definition does not match
+    SnapshotMachine restored;
+    cfsm_state flat_states[1]{};
+    cfsm_init_state(&flat_states[0], "flat");
+    cfsm_state flat{};
+    cfsm_init(&flat, 1, flat_states, &flat_states[0]);
+    cfsm_start(&flat, 0, nullptr);
+    cfsm_post_event(&restored.fsm, cfsm_event_alloc(&pool, 5, 0));
+    struct cfsm_state *restored_fsms[] = {&restored.fsm, &flat};
+
+    rewind(stream);
+    ASSERT_FALSE(cfsm_restore(stream, restored_fsms, 2, &pool));
+    ASSERT_EQ(nullptr, restored.fsm.current_state) << "first instance is not restored alone";
+    ASSERT_EQ(1, cfsm_get_runtime(&restored.fsm)->inbox.size);
+    ASSERT_EQ(&flat_states[0], flat.current_state);
+
+    cfsm_stop(&flat, 0, nullptr);
+    cfsm_state_destroy(&flat);
+}
+
+void snapshotSuspendingAction(struct cfsm_state *, struct cfsm_state *, struct cfsm_state *, int, void *) {}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_restore_abandons_transition_in_flight) {
+    SnapshotMachine original;
+    struct cfsm_state *fsms[] = {&original.fsm};
+    ASSERT_TRUE(cfsm_snapshot(stream, fsms, 1));
+
+    SnapshotMachine restored;
+    cfsm_transition_set_async_action(&restored.t[0], snapshotSuspendingAction);
+    ASSERT_EQ(cfsm_status_pending, cfsm_process_event_sink(&restored.fsm, cfsm_event_alloc(&pool, 1, 8)));
+
+    struct cfsm_state *restored_fsms[] = {&restored.fsm};
+    FILE *scratch = tmpfile();
+    ASSERT_FALSE(cfsm_snapshot(scratch, restored_fsms, 1)) << "transition in flight cannot be captured";
+    fclose(scratch);
+
+    rewind(stream);
+    ASSERT_TRUE(cfsm_restore(stream, restored_fsms, 1, &pool));
+    ASSERT_FALSE(cfsm_is_in_transition(&restored.fsm));
+    ASSERT_EQ(nullptr, restored.fsm.current_state);
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_failed_bulk_restore_leaves_population_untouched) {
+    cfsm_state states[3]{};
+    for (auto &state : states) {
+        cfsm_init_state(&state, "state");
+    }
+    cfsm_state c{};
+    cfsm_init(&c, 3, states, &states[0]);
+    cfsm_bulk bulk{};
+    ASSERT_TRUE(cfsm_bulk_init(&bulk, &c));
+
+    const int population[] = {0, 1, 2, -1};
+    ASSERT_TRUE(cfsm_bulk_snapshot(stream, &bulk, population, 4));
+
+    // truncate last state away
+    std::fseek(stream, 0, SEEK_END);
+    std::vector<char> bytes(std::ftell(stream) - 1);
+    rewind(stream);
+    ASSERT_EQ(bytes.size(), std::fread(bytes.data(), 1, bytes.size(), stream));
+    FILE *truncated = tmpfile();
+    std::fwrite(bytes.data(), 1, bytes.size(), truncated);
+    rewind(truncated);
+
+    std::vector<int> restored(4, 7);
+    ASSERT_FALSE(cfsm_bulk_restore(truncated, &bulk, restored.data(), 4));
+    ASSERT_EQ(std::vector<int>(4, 7), restored);
+
+    fclose(truncated);
+    cfsm_bulk_destroy(&bulk);
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_restore_over_pipe_leaves_trailing_data) {
+    SnapshotMachine original;
+    cfsm_process_event(&original.fsm, 1, nullptr);
+    struct cfsm_state *fsms[] = {&original.fsm};
+
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    FILE *out = fdopen(fds[1], "w");
+    FILE *in = fdopen(fds[0], "r");
+    ASSERT_TRUE(cfsm_snapshot(out, fsms, 1));
+    std::fputs("TRAILER", out);
+    fclose(out);
+
+    SnapshotMachine restored;
+    struct cfsm_state *restored_fsms[] = {&restored.fsm};
+    ASSERT_TRUE(cfsm_restore(in, restored_fsms, 1, &pool));
+    ASSERT_EQ(&restored.top[1], restored.fsm.current_state);
+
+    char trailer[16]{};
+    ASSERT_NE(nullptr, std::fgets(trailer, sizeof(trailer), in));
+    ASSERT_STREQ("TRAILER", trailer);
+    fclose(in);
+}
+
+TEST_F(cfsm_test_snapshot, cfsm_test_restore_rejects_snapshot_of_larger_population) {
+    SnapshotMachine original;
+    struct cfsm_state *fsms[] = {&original.fsm};
+    ASSERT_TRUE(cfsm_snapshot(stream, fsms, 1));
+
+    // same header, but machine definition with sub-machine missing leaves bytes unread
+    cfsm_state states[2]{};
+    cfsm_init_state(&states[0], "a");
+    cfsm_init_state(&states[1], "b");
+    cfsm_state flat{};
+    cfsm_init(&flat, 2, states, &states[0]);
+    struct cfsm_state *flat_fsms[] = {&flat};
+
+    rewind(stream);
+    ASSERT_FALSE(cfsm_restore(stream, flat_fsms, 1, &pool));
+    cfsm_state_destroy(&flat);
+}